@@ -0,0 +1,23 @@
+#ifndef ACCT_H
+#define ACCT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "pcb.h"
+
+/* Finished PCBs kept for each ranking. */
+#define ACCT_KEEP 64
+
+/* Accounting record of a PCB that was freed after running. */
+typedef struct {
+    char p_name[9];
+    ImageId image;
+    uint32_t slices;
+    ResourceUsage usage;
+} AcctRecord;
+
+void acct_record(const PCB *p);
+size_t acct_top(bool by_memory, const AcctRecord **records);
+uint64_t acct_key(const ResourceUsage *usage, bool by_memory);
+
+#endif // ACCT_H
@@ -22,6 +22,7 @@ typedef struct {
 } User;
 
 bool handle_login(void);
+bool switch_user(const char *username);
 const User* get_current_user(void);
 UserRole get_current_user_role(void);
 const char* get_current_user_name(void);
@@ -1,9 +1,11 @@
 #ifndef COMHAN_H
 #define COMHAN_H
 
-/* Symbolic constant for maximum command input length */
-#define MAX_INPUT_LEN 100
-#define MAX_ARGS_COUNT 5  // Maximum number of arguments
+#include <limits.h>
+
+/* Symbolic constant for maximum command input length: room for a full-length path plus the command */
+#define MAX_INPUT_LEN (PATH_MAX + 100)
+#define MAX_ARGS_COUNT 6  // Maximum number of arguments
 #define MAX_ARGS_LEN MAX_INPUT_LEN  // Maximum length for the combined args string
 
 /* Symbolic constant for the prompt */
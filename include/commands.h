@@ -20,10 +20,23 @@ void handle_suspend_pcb(int argc, char *argv[]);
 void handle_resume_pcb(int argc, char *argv[]);
 void handle_set_pcb_priority(int argc, char *argv[]);
 void handle_show_pcb(int argc, char *argv[]);
+void handle_show_pcb_pool(int argc, char *argv[]);
+void handle_show_images(int argc, char *argv[]);
+void handle_compile_image(int argc, char *argv[]);
+void handle_set_pcb_output(int argc, char *argv[]);
+void handle_show_output(int argc, char *argv[]);
 void handle_show_ready_pcbs(int argc, char *argv[]);
 void handle_show_blocked_pcbs(int argc, char *argv[]);
 void handle_load_pcbs(int argc, char *argv[]);
 void handle_dispatch_pcbs(int argc, char *argv[]);
+void handle_set_engine(int argc, char *argv[]);
+void handle_set_io_latency(int argc, char *argv[]);
+void handle_set_quantum(int argc, char *argv[]);
+void handle_set_scheduler(int argc, char *argv[]);
+void handle_show_deadlines(int argc, char *argv[]);
+void handle_show_users(int argc, char *argv[]);
+void handle_sched_stats(int argc, char *argv[]);
+void handle_top_pcbs(int argc, char *argv[]);
 void handle_clear(int argc, char *argv[]);
 void handle_view_directory(int argc, char *argv[]);
 void handle_change_directory(int argc, char *argv[]);
@@ -36,5 +49,6 @@ void handle_remove_user(int argc, char *argv[]);
 void handle_change_password(int argc, char *argv[]);
 void handle_add_admin(int argc, char *argv[]);
 void handle_remove_admin(int argc, char *argv[]);
+void handle_switch_user(int argc, char *argv[]);
 
 #endif
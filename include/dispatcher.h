@@ -1,6 +1,14 @@
 #ifndef DISPATCHER_H
 #define DISPATCHER_H
 
-void dispatch_all(void);
+#define MAX_DISPATCH_CHILDREN 1024
+
+/* Options accepted by the 'dispatchpcbs' command. */
+typedef struct {
+    int workers;  // number of worker threads; 1 dispatches serially on the calling thread
+    int children; // executors kept in flight by the calling thread (external or pool engine only); 1 disables
+} DispatchOptions;
+
+void dispatch_all(const DispatchOptions *options);
 
 #endif // DISPATCHER_H
@@ -0,0 +1,56 @@
+#ifndef EDF_H
+#define EDF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pcb.h"
+
+/* Lateness histogram buckets: on time, under 1 ms, under 2, 4, ... 1024 ms, and 1024 ms or later. */
+#define LATENESS_BUCKETS 13
+
+typedef struct {
+    uint64_t jobs;     // jobs that ran to an interrupt or to completion
+    uint64_t missed;   // jobs that finished after their deadline
+    uint64_t worst_us; // largest lateness seen, in microseconds
+    uint64_t buckets[LATENESS_BUCKETS];
+} DeadlineStats;
+
+/*
+ * Real-time state of a PCB with a deadline. A job is released each time the PCB becomes ready after
+ * being created or blocked, and is due deadline_ms later; it ends when a slice is interrupted or the
+ * process completes. Preempted slices continue the same job.
+ */
+typedef struct edf_info {
+    struct edf_info *next; // every PCB with a deadline, in creation order
+    struct edf_info *prev;
+    PCB *pcb;
+    uint32_t deadline_ms;  // relative deadline of each job
+    uint64_t due_us;       // absolute deadline of the current job, 0 if no job is pending
+    DeadlineStats stats;
+} EdfInfo;
+
+/* Finished PCBs whose deadline counters are kept after they are freed; older ones are dropped. */
+#define EDF_KEEP_FINISHED 64
+
+/* Deadline counters of a PCB that was freed. */
+typedef struct {
+    char p_name[9];
+    uint32_t deadline_ms;
+    DeadlineStats stats;
+} EdfRecord;
+
+int edf_attach(PCB *p, unsigned int deadline_ms);
+void edf_detach(PCB *p);
+void edf_enqueue(PCB *p);
+void edf_remove(PCB *p);
+PCB *edf_pick_next(void);
+void edf_clear_ready(void);
+void edf_on_tick(PCB *p, bool preempted);
+const EdfInfo *edf_list(void);
+const EdfRecord *edf_finished(size_t i);
+const DeadlineStats *edf_totals(void);
+const char *edf_bucket_label(int bucket);
+void edf_cleanup(void);
+
+#endif // EDF_H
@@ -0,0 +1,51 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <sys/types.h>
+#include "pcb.h"
+
+/* Executor binary that runs a single time slice of a process image. */
+#define EXECUTOR_PATH "./execute"
+
+/* Descriptor on which the external executor writes the offset it stopped at, and on which a pool worker talks to TechOS. */
+#define EXECUTOR_RESULT_FD 3
+
+/* Returned by the slice functions when a slice used up its quantum; the offset it reports is where execution resumes. */
+#define SLICE_PREEMPTED 1
+
+/* How a time slice is executed. */
+typedef enum {
+    ENGINE_INPROC,   // scan the registered image inside TechOS
+    ENGINE_EXTERNAL, // spawn the external execute binary per slice
+    ENGINE_POOL      // send slices to long-lived execute workers
+} EngineMode;
+
+/* Limit on how much of an image a single slice may execute. */
+typedef enum {
+    QUANTUM_NONE,  // a slice runs until the next interrupt
+    QUANTUM_BYTES, // a slice executes at most amount bytes
+    QUANTUM_MS     // a slice runs for at most amount milliseconds
+} QuantumKind;
+
+typedef struct {
+    QuantumKind kind;
+    unsigned long long amount;
+} Quantum;
+
+/* An external executor that has been spawned but not yet reaped. */
+typedef struct {
+    pid_t pid;
+    int result_fd; // read end of the pipe the executor writes its result to
+} ExternalSlice;
+
+void engine_set_mode(EngineMode mode);
+EngineMode engine_get_mode(void);
+const char *engine_mode_name(EngineMode mode);
+int engine_parse_mode(const char *str, EngineMode *mode);
+void engine_set_quantum(const Quantum *quantum);
+const Quantum *engine_get_quantum(void);
+int engine_run_slice(PCB *p, off_t *next_offset);
+int engine_spawn_external(const PCB *p, ExternalSlice *slice);
+int engine_collect_external(PCB *p, ExternalSlice *slice, off_t *next_offset);
+
+#endif // ENGINE_H
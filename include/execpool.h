@@ -0,0 +1,19 @@
+#ifndef EXECPOOL_H
+#define EXECPOOL_H
+
+#include <sys/types.h>
+#include "pcb.h"
+#include "parallel.h"
+
+#define MAX_POOL_WORKERS 256
+
+int execpool_start(int workers);
+int execpool_capacity(void);
+int execpool_size(void);
+unsigned long execpool_respawns(void);
+void execpool_submit(PCB *p);
+void execpool_wait(SliceResult *result);
+int execpool_run(PCB *p, off_t *next_offset);
+void execpool_stop(void);
+
+#endif // EXECPOOL_H
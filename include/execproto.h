@@ -0,0 +1,34 @@
+#ifndef EXECPROTO_H
+#define EXECPROTO_H
+
+#include <stdint.h>
+
+/*
+ * Wire protocol between TechOS and a pool worker ('execute --serve <fd>').
+ * TechOS sends an ExecJob followed by path_len bytes of the image path (no terminator) and the
+ * worker answers with an ExecReply. Both travel over one connected stream socket per worker.
+ */
+
+#define EXECUTOR_SERVE_FLAG "--serve"
+
+typedef struct {
+    int64_t offset;      // offset to start scanning from
+    uint64_t max_bytes;  // byte quantum of the slice, 0 for none
+    uint32_t quantum_ms; // time quantum of the slice, 0 for none
+    uint32_t path_len;   // length of the path that follows, 1 to PATH_MAX - 1
+} ExecJob;
+
+typedef struct {
+    int64_t next_offset; // offset of the next interrupt, 0 if the image ran to completion, -1 on error;
+                         // when preempted, the offset execution resumes from
+    uint32_t preempted;  // 1 if the slice used up its quantum
+    uint32_t reserved;
+    /* Resources the worker used for the slice, from getrusage() before and after it. */
+    uint64_t utime_us;   // user CPU time
+    uint64_t stime_us;   // system CPU time
+    uint64_t maxrss_kb;  // always 0: the worker's high-water mark spans every job it ran
+    uint64_t nvcsw;      // voluntary context switches
+    uint64_t nivcsw;     // involuntary context switches
+} ExecReply;
+
+#endif // EXECPROTO_H
@@ -0,0 +1,55 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "imgindex.h"
+#include "resusage.h"
+
+/* Images larger than this are streamed with pread() instead of being mapped.
+ * Can be overridden at build time, e.g. -DIMAGE_MAP_LIMIT=0 to stream every image. */
+#ifndef IMAGE_MAP_LIMIT
+#define IMAGE_MAP_LIMIT ((off_t)1 << 30)
+#endif
+
+/* Streamed images are read in aligned chunks of this size. */
+#define IMAGE_CHUNK_BYTES (1 << 20)
+
+/* Upper bound of the region image_prefetch() asks the kernel to read ahead. */
+#define IMAGE_PREFETCH_MAX (8 << 20)
+
+/* Handle of a registered process image. 0 means "no image". */
+typedef uint32_t ImageId;
+
+#define NO_IMAGE 0
+
+/* A process image file, registered once and shared by every PCB that runs it. */
+typedef struct {
+    char *path;                // canonical path of the file
+    const unsigned char *data; // read-only mapping of the whole file, NULL if the file is empty or streamed
+    int stream_fd;             // descriptor of a streamed image, -1 if the image is mapped
+    off_t size;
+    dev_t dev;
+    ino_t ino;
+    ImageStamp stamp;          // version of the file the contents were loaded from
+    bool stale;                // the file changed and could not be reloaded; slices from it fail
+    unsigned int refs;         // PCBs currently referencing the image
+    ImageIndex index;          // precomputed interrupt offsets, if a valid index was compiled
+    ResourceUsage usage;       // usage of every slice run from the image, by any PCB
+} ProcessImage;
+
+ImageId image_register(const char *path);
+void image_release(ImageId id);
+const ProcessImage *image_get(ImageId id);
+ImageId image_count(void);
+void image_revalidate(void);
+void image_reindex(const char *path);
+void image_charge(ImageId id, const ResourceUsage *usage);
+const unsigned char *image_read(const ProcessImage *img, off_t offset, size_t *len);
+int image_next_interrupt(const ProcessImage *img, off_t start, off_t end, off_t *next_offset);
+void image_prefetch(const ProcessImage *img, off_t offset);
+void image_cleanup(void);
+
+#endif // IMAGE_H
@@ -0,0 +1,61 @@
+#ifndef IMGINDEX_H
+#define IMGINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* Byte that marks an interrupt in an encoded process image ('!' shifted by 5). */
+#define INTERRUPT_BYTE ('!' + 5)
+
+/* Suffix appended to an image path to name its interrupt index. */
+#define IMGINDEX_SUFFIX ".idx"
+
+#define IMGINDEX_MAGIC "TOSIDX\0"
+#define IMGINDEX_VERSION 2
+
+/*
+ * One version of an image file: its size, inode, and modification and status change times to the
+ * nanosecond. A rewrite within the same second, a same-size rewrite and a file replaced by a rename
+ * all change it, unlike the size and whole-second mtime alone.
+ */
+typedef struct {
+    uint64_t size;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+} ImageStamp;
+
+/*
+ * On-disk header of an interrupt index, followed by `count` native-endian uint64_t offsets of
+ * every interrupt byte in the image, in ascending order. The index is only trusted while the
+ * image still has the recorded stamp.
+ */
+typedef struct {
+    char magic[8];        // IMGINDEX_MAGIC
+    uint32_t version;     // IMGINDEX_VERSION
+    uint32_t reserved;
+    ImageStamp image;
+    uint64_t count;
+} ImageIndexHeader;
+
+/* A loaded interrupt index. `map` is NULL when the image has no valid index. */
+typedef struct {
+    const uint64_t *offsets;
+    uint64_t count;
+    void *map;
+    size_t map_size;
+} ImageIndex;
+
+void imgindex_stamp(const struct stat *st, ImageStamp *stamp);
+bool imgindex_stamp_equal(const ImageStamp *a, const ImageStamp *b);
+long long imgindex_compile(const char *image_path);
+int imgindex_open(const char *image_path, const ImageStamp *image, ImageIndex *index);
+off_t imgindex_next(const ImageIndex *index, off_t start);
+void imgindex_close(ImageIndex *index);
+
+#endif // IMGINDEX_H
@@ -0,0 +1,51 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* Handle of an output sink. 0 means "output is discarded". */
+typedef uint8_t SinkId;
+
+#define NO_SINK 0
+#define STDOUT_SINK 1
+#define MAX_OUTPUT_SINKS 255
+
+/* Decoded bytes staged per stdout or file sink before they are written with one writev(). */
+#define OUTPUT_BATCH_BYTES (256 * 1024)
+#define OUTPUT_BATCH_IOVECS 64
+
+/* Default ring buffer size in KiB. */
+#define DEFAULT_RING_KIB 64
+
+typedef enum { SINK_NONE, SINK_STDOUT, SINK_FILE, SINK_RING } SinkKind;
+
+/* Where the decoded output of one or more PCBs goes. */
+typedef struct {
+    SinkKind kind;
+    unsigned int refs;           // PCBs currently writing to the sink
+    int fd;                      // stdout and file sinks
+    char *path;                  // file sinks
+    unsigned char *data;         // staged batch (stdout, file) or ring storage (ring)
+    size_t capacity;             // size of data
+    size_t used;                 // bytes staged, or bytes held by the ring
+    size_t head;                 // ring: position of the next byte written
+    unsigned long long written;  // decoded bytes emitted in total
+    struct iovec iov[OUTPUT_BATCH_IOVECS];
+    int iov_count;
+    char labels[OUTPUT_BATCH_IOVECS][12]; // "[name] " prefixes of stdout segments
+} OutputSink;
+
+SinkId output_open_stdout(void);
+SinkId output_open_file(const char *path);
+SinkId output_open_ring(size_t capacity);
+void output_release(SinkId id);
+const OutputSink *output_get(SinkId id);
+const char *output_kind_name(SinkKind kind);
+void output_slice(SinkId id, const char *label, const unsigned char *data, size_t len);
+size_t output_ring_read(SinkId id, const unsigned char *parts[2], size_t lens[2]);
+void output_flush(void);
+void output_cleanup(void);
+
+#endif // OUTPUT_H
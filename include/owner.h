@@ -0,0 +1,32 @@
+#ifndef OWNER_H
+#define OWNER_H
+
+#include <stdint.h>
+#include "auth.h"
+#include "pcbheap.h"
+
+/* Index of an owner in the owner registry; 0 means the PCB has no owner. */
+typedef uint16_t OwnerId;
+#define NO_OWNER 0
+
+/*
+ * A user who created PCBs in this session. Owners are registered the first time the logged-in user
+ * creates a PCB and stay registered until TechOS exits, so their counters outlive their PCBs.
+ */
+typedef struct {
+    char name[MAX_USERNAME_LEN];
+    UserRole role;       // role the user had when they last created a PCB
+    uint32_t pcbs;       // PCBs of the user that exist now
+    uint64_t slices;     // slices executed for the user's PCBs
+    uint64_t vruntime;   // fair share: slices charged to the user, scaled down by the role's weight
+    PCBHeap ready;       // fair share: the user's ready PCBs, highest priority first
+} Owner;
+
+OwnerId owner_current(void);
+Owner *owner_get(OwnerId id);
+OwnerId owner_count(void);
+unsigned int owner_weight(const Owner *owner);
+const char *owner_role_name(UserRole role);
+void owner_cleanup(void);
+
+#endif // OWNER_H
@@ -0,0 +1,23 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <sys/types.h>
+#include "pcb.h"
+
+#define MAX_DISPATCH_WORKERS 256
+
+/* Outcome of a time slice executed by a worker thread. */
+typedef struct {
+    PCB *p;
+    int status;        // 0 on success, SLICE_PREEMPTED if preempted, -1 if the slice could not be executed
+    off_t next_offset; // offset of the next interrupt, or 0 if the process completed
+    int worker;        // index of the worker that ran the slice
+} SliceResult;
+
+int parallel_start(int workers);
+int parallel_capacity(void);
+void parallel_submit(PCB *p);
+void parallel_wait(SliceResult *result);
+void parallel_stop(void);
+
+#endif // PARALLEL_H
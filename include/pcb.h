@@ -2,30 +2,66 @@
 #define PCB_H
 
 #include <limits.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include <stdbool.h>
+#include "pool.h"
+#include "image.h"
+#include "output.h"
+#include "resusage.h"
 
 typedef enum { READY, RUNNING, BLOCKED } PCBState;
 
-/* Process Control Block */
+/* Per-process state that queue walks never touch, kept out of the PCB's cache line. */
+typedef struct pcb_ext {
+    uint64_t pass;       // stride scheduling: virtual time at which the process runs next
+    uint32_t heap_index; // position in the scheduler's heap while the process is filed there
+    uint32_t epoch;      // MLFQ: epoch of its level when the process was filed there
+    uint8_t depth;       // MLFQ: levels below the top level
+    uint16_t owner;      // OwnerId of the user who created the process
+    uint32_t slices;     // slices dispatched so far
+    /* Monotonic timestamps in microseconds, for schedstats. */
+    uint64_t created_us;   // creation
+    uint64_t ready_us;     // latest arrival in the ready queue
+    ResourceUsage slice_usage; // usage of the slice that just ran, until the dispatcher accounts for it
+    ResourceUsage usage;       // usage of every slice so far
+    struct edf_info *edf; // deadline of a system-class process, NULL if it has none
+} PCBExt;
+
+/* Process Control Block.
+ * Only the fields touched by queue walks and the dispatcher live here, so a PCB fits in one
+ * cache line; the process image is referenced through the image registry. */
 typedef struct pcb {
     char p_name[9]; // 8 chars + '\0'
-    int p_class; // 0=system, 1=application
-    int priority; // 0–9
-    PCBState state; // ready, running, blocked
+    uint8_t p_class; // 0=system, 1=application
+    uint8_t priority; // 0–9
+    uint8_t state; // PCBState: ready, running, blocked
     bool suspended;
+    uint8_t level; // level the PCB is filed under in a priority-ordered queue
     struct pcb *next; // next PCB in the queue
     struct pcb *prev; // previous PCB in the queue
-    char file_path[PATH_MAX]; // file that will be executed
-    int offset; // offset in the file to start execution. 0 by default
+    off_t offset; // offset in the file to start execution. 0 by default
+    ImageId image; // process image that will be executed, NO_IMAGE if none
+    SinkId sink; // where decoded output goes, NO_SINK to discard it
+    struct timer *timer; // wakeup deadline while blocked, NULL if none
+    PCBExt *ext; // cold per-process state, allocated with the PCB
 } PCB;
 
+/* Size of a cache line. PCBs are allocated on cache line boundaries. */
+#define PCB_CACHE_LINE 64
+
+_Static_assert(sizeof(PCB) <= PCB_CACHE_LINE, "PCB must fit in a single cache line");
+
 
+void init_pcbs(void);
 PCB *allocate_pcb(void);
 int free_pcb(PCB *p);
 void insert_pcb(PCB *p);
-PCB *setup_pcb(const char *p_name, int p_class, int priority, const char *file_path);
+PCB *setup_pcb(const char *p_name, int p_class, int priority, ImageId image, unsigned int deadline_ms);
 PCB *find_pcb(const char *p_name);
 int remove_pcb(PCB *p);
+const Pool *get_pcb_pool(void);
+void cleanup_pcbs(void);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef PCBHEAP_H
+#define PCBHEAP_H
+
+#include <stdint.h>
+#include "pcb.h"
+
+/* One PCB filed in a heap under a key. seq breaks ties, so PCBs with equal keys leave in the order they came. */
+typedef struct {
+    uint64_t key;
+    uint64_t seq;
+    PCB *pcb;
+} HeapEntry;
+
+/*
+ * Binary min-heap of PCBs. Each PCB records its position in PCBExt.heap_index, so a PCB can be
+ * removed from anywhere in the heap in O(log n). A PCB can be filed in only one heap at a time.
+ */
+typedef struct {
+    HeapEntry *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t seq; // sequence number of the next push
+} PCBHeap;
+
+int pcbheap_push(PCBHeap *heap, PCB *p, uint64_t key);
+PCB *pcbheap_top(const PCBHeap *heap);
+uint64_t pcbheap_top_key(const PCBHeap *heap);
+void pcbheap_remove(PCBHeap *heap, PCB *p);
+void pcbheap_clear(PCBHeap *heap);
+
+#endif // PCBHEAP_H
@@ -0,0 +1,30 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/* A slab of objects carved out of a single allocation. */
+typedef struct pool_slab {
+    struct pool_slab *next;
+} PoolSlab;
+
+/* Fixed-size object pool: objects come from slabs, and freed objects go onto an intrusive free list. */
+typedef struct {
+    size_t object_size;   // rounded up so every object can hold a free-list link and the next one stays aligned
+    size_t alignment;     // alignment of every object, at least alignof(max_align_t)
+    size_t per_slab;      // objects per slab
+    PoolSlab *slabs;      // every slab allocated so far
+    void *free_list;      // freed objects, linked through their first word
+    size_t slab_count;
+    size_t bump;          // next never-used object index in the newest slab
+    size_t in_use;        // objects currently allocated
+    size_t high_water;    // largest in_use seen since the last reset
+} Pool;
+
+void pool_init(Pool *pool, size_t object_size, size_t alignment, size_t per_slab);
+void *pool_alloc(Pool *pool);
+void pool_free(Pool *pool, void *object);
+void pool_reset(Pool *pool);
+size_t pool_capacity(const Pool *pool);
+
+#endif // POOL_H
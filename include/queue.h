@@ -1,12 +1,31 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
+#include <stdint.h>
 #include "pcb.h"
 
+/* Number of priority levels (0-9). */
+#define PRIORITY_LEVELS 10
+
+/* Level above every priority, for system PCBs with a deadline; the EDF heap orders them. */
+#define REALTIME_LEVEL PRIORITY_LEVELS
+
+/* Levels of a priority-ordered queue. */
+#define QUEUE_LEVELS (PRIORITY_LEVELS + 1)
+
+/* PCB level of a PCB filed in FIFO order. */
+#define NO_LEVEL 0xFF
+
 typedef struct {
     int   count;
     PCB  *head;
     PCB  *tail;
+    /* Priority-ordered queues only: first and last PCB of each priority level within the list,
+     * the number of PCBs in each level, and a bitmap with bit n set while level n is non-empty. */
+    PCB  *level_head[QUEUE_LEVELS];
+    PCB  *level_tail[QUEUE_LEVELS];
+    int   level_count[QUEUE_LEVELS];
+    uint16_t levels;
 } Queue;
 
 extern Queue g_ready_queue;
@@ -15,11 +34,14 @@ extern Queue g_suspended_ready_queue;
 extern Queue g_suspended_blocked_queue;
 
 void init_queues(void);
-void enqueue_ready(PCB *p);
+void queue_push_level(Queue *q, PCB *p, int level);
+void queue_push_priority(Queue *q, PCB *p);
+void queue_push_back(Queue *q, PCB *p);
 void enqueue_blocked(PCB *p);
 void enqueue_suspended_ready(PCB *p);
 void enqueue_suspended_blocked(PCB *p);
 void dequeue(Queue *q, PCB *p);
+PCB *peek_highest(const Queue *q);
 void dump_queue(const char *title, Queue *q);
 void cleanup_queue(Queue *q);
 
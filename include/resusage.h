@@ -0,0 +1,20 @@
+#ifndef RESUSAGE_H
+#define RESUSAGE_H
+
+#include <stdint.h>
+#include <sys/resource.h>
+
+/* CPU time, memory and context switches used by slices, as reported by getrusage() or wait4(). */
+typedef struct {
+    uint64_t utime_us;  // user CPU time
+    uint64_t stime_us;  // system CPU time
+    uint64_t maxrss_kb; // largest resident set of an executor child that ran the slices, 0 if unavailable
+    uint64_t nvcsw;     // voluntary context switches
+    uint64_t nivcsw;    // involuntary context switches
+} ResourceUsage;
+
+void resusage_between(const struct rusage *before, const struct rusage *after, ResourceUsage *usage);
+void resusage_set_cpu(ResourceUsage *usage, uint64_t cpu_us);
+void resusage_add(ResourceUsage *total, const ResourceUsage *usage);
+
+#endif // RESUSAGE_H
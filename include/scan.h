@@ -0,0 +1,25 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+/* Finds the first interrupt byte in data[0, len), returning NULL if there is none. */
+typedef const unsigned char *(*ScanFunction)(const unsigned char *data, size_t len);
+
+/* Decodes len encoded image bytes from src into dst by undoing the +5 shift. */
+typedef void (*DecodeFunction)(unsigned char *dst, const unsigned char *src, size_t len);
+
+/* A set of kernels for one instruction set and the name it is reported under. */
+typedef struct {
+    const char *name;
+    ScanFunction scan;
+    DecodeFunction decode;
+} ScanKernel;
+
+const unsigned char *scan_interrupt(const unsigned char *data, size_t len);
+void scan_decode(unsigned char *dst, const unsigned char *src, size_t len);
+const char *scan_kernel_name(void);
+size_t scan_kernel_count(void);
+const ScanKernel *scan_kernel(size_t i);
+
+#endif // SCAN_H
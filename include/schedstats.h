@@ -0,0 +1,51 @@
+#ifndef SCHEDSTATS_H
+#define SCHEDSTATS_H
+
+#include <stdint.h>
+#include "pcb.h"
+#include "queue.h"
+
+/*
+ * Log-linear histogram in the style of HdrHistogram: values below 2^STATS_SUB_BUCKET_BITS get a bucket each,
+ * and every power of two above is split into 2^STATS_SUB_BUCKET_BITS equal buckets, so a recorded value is
+ * known to within 1/16 of itself. Values above 2^(STATS_MAX_MAGNITUDE + 1) - 1 (about 25 days in
+ * microseconds) are clamped.
+ */
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+#define STATS_MAX_MAGNITUDE 40
+#define STATS_BUCKETS ((STATS_MAX_MAGNITUDE - STATS_SUB_BUCKET_BITS + 2) * STATS_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[STATS_BUCKETS];
+} Histogram;
+
+/* What is measured. Times are in microseconds of CLOCK_MONOTONIC. */
+typedef enum {
+    STAT_WAIT,       // time a PCB spent in the ready queue before a slice was dispatched, per slice
+    STAT_RESPONSE,   // time from creation to the first slice, per PCB
+    STAT_TURNAROUND, // time from creation to completion or failure, per PCB
+    STAT_SLICES,     // slices dispatched for a PCB by its completion or failure
+    STAT_METRICS
+} SchedMetric;
+
+/* Each metric is kept for all PCBs, for each priority and for each class. */
+#define STATS_GROUP_ALL 0
+#define STATS_GROUP_PRIORITY(priority) (1 + (priority))
+#define STATS_GROUP_CLASS(p_class) (1 + PRIORITY_LEVELS + (p_class))
+#define STATS_GROUPS (1 + PRIORITY_LEVELS + 2)
+
+void schedstats_on_create(PCB *p);
+void schedstats_on_ready(PCB *p);
+void schedstats_on_dispatch(PCB *p);
+void schedstats_on_exit(const PCB *p);
+const Histogram *schedstats_get(SchedMetric metric, int group);
+double schedstats_elapsed(void);
+void schedstats_reset(void);
+uint64_t histogram_percentile(const Histogram *h, double percentile);
+
+#endif // SCHEDSTATS_H
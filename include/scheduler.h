@@ -0,0 +1,66 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include "pcb.h"
+#include "queue.h"
+
+/* Policies that decide which ready PCB runs next. */
+typedef enum {
+    SCHED_PRIORITY,  // highest priority first, FIFO within a priority level
+    SCHED_FIFO,      // in the order PCBs became ready
+    SCHED_SJF,       // shortest job first, by image size or remaining bytes
+    SCHED_LOTTERY,   // random draw, priority + 1 tickets per PCB
+    SCHED_STRIDE,    // deterministic proportional share, priority + 1 tickets per PCB
+    SCHED_MLFQ,      // multilevel feedback queue
+    SCHED_FAIRSHARE, // users take turns by virtual runtime weighted by role
+    SCHED_POLICIES
+} SchedPolicyId;
+
+/* MLFQ levels are the ready queue's levels; new PCBs start at the top one. */
+#define MLFQ_TOP_LEVEL (PRIORITY_LEVELS - 1)
+
+/* Default MLFQ aging threshold, in slices a level is passed over. */
+#define MLFQ_DEFAULT_AGING 64
+
+/* Virtual runtime a fair-share slice costs an owner of weight 1; an owner of weight w is charged FAIRSHARE_SLICE / w. */
+#define FAIRSHARE_SLICE (1ULL << 20)
+
+/* What the SJF policy measures a job by. */
+typedef enum {
+    SJF_REMAINING, // bytes of the image not executed yet
+    SJF_SIZE       // size of the whole image
+} SjfBasis;
+
+/*
+ * A scheduling policy. The ready queue list always holds every ready PCB so it can be listed
+ * and counted; the policy decides where PCBs go in it and may keep its own index on the side.
+ * Hooks a policy does not need are NULL.
+ */
+typedef struct {
+    const char *name;
+    void (*enqueue)(PCB *p);                 // files a PCB that became ready
+    void (*remove)(PCB *p);                  // takes a PCB out of the ready queue
+    PCB *(*pick_next)(void);                 // PCB to run next, left in the ready queue; NULL if none
+    void (*on_tick)(PCB *p, bool preempted); // a slice of the PCB finished executing
+    void (*on_block)(PCB *p);                // the PCB was interrupted and waits for its I/O
+    void (*on_complete)(PCB *p);             // the PCB completed or failed and is about to be freed
+} SchedPolicy;
+
+void scheduler_set_policy(SchedPolicyId id);
+SchedPolicyId scheduler_get_policy(void);
+const char *scheduler_policy_name(SchedPolicyId id);
+int scheduler_parse_policy(const char *str, SchedPolicyId *id);
+void scheduler_set_sjf_basis(SjfBasis basis);
+SjfBasis scheduler_get_sjf_basis(void);
+void scheduler_set_mlfq_aging(unsigned int slices);
+unsigned int scheduler_get_mlfq_aging(void);
+void scheduler_enqueue(PCB *p);
+void scheduler_remove(PCB *p);
+PCB *scheduler_pick_next(void);
+void scheduler_on_tick(PCB *p, bool preempted);
+void scheduler_on_block(PCB *p);
+void scheduler_on_complete(PCB *p);
+void scheduler_cleanup(void);
+
+#endif // SCHEDULER_H
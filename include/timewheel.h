@@ -0,0 +1,49 @@
+#ifndef TIMEWHEEL_H
+#define TIMEWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+/* Longest delay a timer can be set to, in ticks; longer delays are clamped. */
+#define WHEEL_MAX_DELAY ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/* A timer linked into one slot of a wheel. The memory belongs to the caller. */
+typedef struct timer {
+    struct timer *next;
+    struct timer *prev;
+    uint64_t expires; // tick at which the timer fires
+    void *data;       // owner of the timer
+    int16_t slot;     // level * WHEEL_SLOTS + slot index while armed, -1 otherwise
+} Timer;
+
+/* Timers of one slot, in the order they were added. */
+typedef struct {
+    Timer *head;
+    Timer *tail;
+} TimerList;
+
+/*
+ * Hierarchical timing wheel: level n has WHEEL_SLOTS slots of WHEEL_SLOTS^n ticks each. Timers
+ * are added and cancelled in O(1); a timer in an upper level is moved down a level each time the
+ * level below wraps, so expiry costs amortized O(1) per timer however far ahead it was set.
+ */
+typedef struct {
+    uint64_t now;                                 // next tick to process; every earlier timer has fired
+    TimerList slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_LEVELS];              // bit n set while slot n of the level is non-empty
+    size_t count;                                 // armed timers
+} TimeWheel;
+
+typedef void (*TimerCallback)(Timer *timer, void *ctx);
+
+void timewheel_init(TimeWheel *wheel, uint64_t now);
+void timewheel_add(TimeWheel *wheel, Timer *timer, uint64_t expires);
+void timewheel_cancel(TimeWheel *wheel, Timer *timer);
+size_t timewheel_advance(TimeWheel *wheel, uint64_t now, TimerCallback fire, void *ctx);
+uint64_t timewheel_next_event(const TimeWheel *wheel);
+
+#endif // TIMEWHEEL_H
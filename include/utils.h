@@ -1,6 +1,7 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
 #include <time.h>
 
 /**
@@ -23,6 +24,7 @@ typedef struct {
 void init_techos_date(void);
 void get_techos_date_str(char *buffer, size_t size);
 void get_current_time_str(char *buffer, size_t size);
+uint64_t monotonic_us(void);
 DateValidationResult validate_date_components(int month, int day, int year);
 void set_techos_date(int month, int day, int year);
 void trim_whitespace(char *str);
@@ -31,6 +33,7 @@ int validate_name(const char *name);
 int validate_priority(const char *str, int *priority);
 int validate_class(const char *str, int *p_class);
 int validate_file_path(const char *file_name);
+int build_image_path(const char *name, char *buf, size_t size);
 int is_directory_empty(const char *path);
 void get_secure_password(char *buffer, size_t size);
 
@@ -0,0 +1,43 @@
+#ifndef WAITCHAN_H
+#define WAITCHAN_H
+
+#include "queue.h"
+
+/* Wait channels: each parks the PCBs of one non-ready queue until a wakeup is posted to it. */
+typedef enum {
+    WAIT_EVENT,  // blocked by the user ('blockpcb'), parked in the blocked queue
+    WAIT_IO,     // interrupted by a slice, parked in the suspended-blocked queue
+    WAIT_RESUME, // suspended by the user while ready, parked in the suspended-ready queue
+    WAIT_CHANNELS
+} WaitChannelId;
+
+/* Service-time distribution of the simulated I/O started when a slice is interrupted. */
+typedef enum {
+    LATENCY_NONE,    // the I/O completes at once
+    LATENCY_FIXED,   // always min_ms
+    LATENCY_UNIFORM, // uniform in [min_ms, max_ms]
+    LATENCY_EXP      // exponential with mean min_ms
+} LatencyKind;
+
+typedef struct {
+    LatencyKind kind;
+    unsigned int min_ms;
+    unsigned int max_ms;
+} IoLatency;
+
+int waitchan_open(void);
+void waitchan_close(void);
+const char *waitchan_name(WaitChannelId id);
+void waitchan_post(WaitChannelId id, unsigned int count);
+unsigned long waitchan_pending(void);
+int waitchan_dispatch(int timeout_ms);
+int waitchan_sleep(PCB *p, unsigned int ms);
+void waitchan_cancel(PCB *p);
+long long waitchan_remaining(const PCB *p);
+unsigned long waitchan_sleeping(void);
+void waitchan_start_io(PCB *p);
+void waitchan_set_latency(const IoLatency *latency);
+const IoLatency *waitchan_get_latency(void);
+void waitchan_cleanup(void);
+
+#endif // WAITCHAN_H
@@ -0,0 +1,89 @@
+#include "acct.h"
+#include <string.h>
+
+/*
+ * The ACCT_KEEP finished PCBs that used the most CPU time, and those with the largest resident set. Each table
+ * is a binary min-heap on its key, so a finished PCB only has to beat the root to get in: O(log ACCT_KEEP) per
+ * PCB however many finish.
+ */
+typedef struct {
+    AcctRecord records[ACCT_KEEP];
+    size_t count;
+    bool by_memory;
+} AcctTable;
+
+static AcctTable g_top_cpu = { .by_memory = false };
+static AcctTable g_top_memory = { .by_memory = true };
+
+/**
+ * @brief Returns the value a usage is ranked by: CPU time (user and system) or resident set size.
+ */
+uint64_t acct_key(const ResourceUsage *usage, const bool by_memory) {
+    return by_memory ? usage->maxrss_kb : usage->utime_us + usage->stime_us;
+}
+
+static uint64_t record_key(const AcctTable *table, const size_t i) {
+    return acct_key(&table->records[i].usage, table->by_memory);
+}
+
+static void swap_records(AcctTable *table, const size_t a, const size_t b) {
+    const AcctRecord tmp = table->records[a];
+    table->records[a] = table->records[b];
+    table->records[b] = tmp;
+}
+
+/**
+ * @brief Adds a record to a table, evicting the smallest one if the table is full and the record is larger.
+ */
+static void table_offer(AcctTable *table, const AcctRecord *record) {
+    const uint64_t key = acct_key(&record->usage, table->by_memory);
+    size_t i;
+    if (table->count < ACCT_KEEP) {
+        i = table->count++;
+        table->records[i] = *record;
+        while (i > 0 && record_key(table, (i - 1) / 2) > key) {
+            swap_records(table, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+    if (key <= record_key(table, 0)) return;
+
+    table->records[0] = *record;
+    i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= table->count) break;
+        if (child + 1 < table->count && record_key(table, child + 1) < record_key(table, child)) child++;
+        if (record_key(table, child) >= key) break;
+        swap_records(table, i, child);
+        i = child;
+    }
+}
+
+/**
+ * @brief Records the usage of a PCB that is being freed. PCBs that never ran are skipped.
+ * @param p Pointer to the PCB.
+ */
+void acct_record(const PCB *p) {
+    if (p->ext->slices == 0) return;
+    AcctRecord record;
+    memcpy(record.p_name, p->p_name, sizeof(record.p_name));
+    record.image = p->image;
+    record.slices = p->ext->slices;
+    record.usage = p->ext->usage;
+    table_offer(&g_top_cpu, &record);
+    table_offer(&g_top_memory, &record);
+}
+
+/**
+ * @brief Returns the finished PCBs that used the most CPU time or memory, in no particular order.
+ * @param by_memory Whether to rank by resident set size instead of CPU time.
+ * @param records Receives a pointer to the records.
+ * @return Number of records, at most ACCT_KEEP.
+ */
+size_t acct_top(const bool by_memory, const AcctRecord **records) {
+    const AcctTable *table = by_memory ? &g_top_memory : &g_top_cpu;
+    *records = table->records;
+    return table->count;
+}
@@ -116,6 +116,27 @@ bool handle_login(void) {
     return false;
 }
 
+/**
+ * @brief Logs in as another user during the session.
+ * @details Prompts for the user's password once. On failure the current user stays logged in.
+ * @param username The user to log in as.
+ * @return true if the credentials are valid, false otherwise.
+ */
+bool switch_user(const char *username) {
+    char password[MAX_PASSWORD_LEN];
+    printf("%sPassword: %s", BLUE, RESET);
+    fflush(stdout);
+    get_secure_password(password, sizeof(password));
+    printf("\n");
+
+    if (!validate_credentials(username, password)) {
+        printf("%sError: Invalid username or password.%s\n", RED, RESET);
+        return false;
+    }
+    printf("%sLogged in as %s.%s\n", GREEN, g_current_user.username, RESET);
+    return true;
+}
+
 /**
  * @brief Gets the currently logged-in user's data.
  * @return A constant pointer to the current user's struct.
@@ -18,19 +18,32 @@ static const Command command_table[] = {
     {"showtime", handle_show_time, 0, 0, "showtime"},
     {"exit", handle_terminate, 0, 0, "exit"},
     {"quit", handle_terminate, 0, 0, "quit"},
-    {"createpcb", handle_create_pcb, 3, 3, "createpcb <name> <class> <priority>"},
+    {"createpcb", handle_create_pcb, 3, 5, "createpcb <name> <class> <priority> [--deadline <ms>]"},
     {"showallpcbs", handle_show_all_pcbs, 0, 0, "showallpcbs"},
     {"deletepcb", handle_delete_pcb, 1, 1, "deletepcb <name>"},
-    {"blockpcb", handle_block_pcb, 1, 1, "blockpcb <name>"},
+    {"blockpcb", handle_block_pcb, 1, 2, "blockpcb <name> [<ms>]"},
     {"unblockpcb", handle_unblock_pcb, 1, 1, "unblockpcb <name>"},
     {"suspendpcb", handle_suspend_pcb, 1, 1, "suspendpcb <name>"},
     {"resumepcb", handle_resume_pcb, 1, 1, "resumepcb <name>"},
     {"setpcbpriority", handle_set_pcb_priority, 2, 2, "setpcbpriority <name> <priority>"},
     {"showpcb", handle_show_pcb, 1, 1, "showpcb <name>"},
+    {"showpcbpool", handle_show_pcb_pool, 0, 0, "showpcbpool"},
     {"showreadypcbs", handle_show_ready_pcbs, 0, 2, "showreadypcbs"},
     {"showblockedpcbs", handle_show_blocked_pcbs, 0, 0, "showblockedpcbs"},
-    {"loadpcb", handle_load_pcbs, 3, 3, "loadpcb <name> <priority> <file_path>"},
-    {"dispatchpcbs", handle_dispatch_pcbs, 0, 0, "dispatchpcbs"},
+    {"loadpcb", handle_load_pcbs, 3, 5, "loadpcb <name> <priority> <file_path> [--deadline <ms>]"},
+    {"showdeadlines", handle_show_deadlines, 0, 0, "showdeadlines"},
+    {"showusers", handle_show_users, 0, 0, "showusers"},
+    {"schedstats", handle_sched_stats, 0, 1, "schedstats [reset]"},
+    {"toppcbs", handle_top_pcbs, 0, 2, "toppcbs [cpu|mem] [<count>]"},
+    {"showimages", handle_show_images, 0, 0, "showimages"},
+    {"compileimage", handle_compile_image, 1, 1, "compileimage <file>"},
+    {"setpcboutput", handle_set_pcb_output, 2, 3, "setpcboutput <name> <none|stdout|file <path>|ring [<KiB>]>"},
+    {"showoutput", handle_show_output, 0, 1, "showoutput [<sink>]"},
+    {"dispatchpcbs", handle_dispatch_pcbs, 0, 4, "dispatchpcbs [-w <workers> | -k <children>]"},
+    {"setengine", handle_set_engine, 0, 1, "setengine <inproc|external|pool>"},
+    {"setiolatency", handle_set_io_latency, 0, 3, "setiolatency [none | fixed <ms> | uniform <min> <max> | exp <mean>]"},
+    {"setquantum", handle_set_quantum, 0, 2, "setquantum [off | bytes <n> | ms <n>]"},
+    {"setscheduler", handle_set_scheduler, 0, 2, "setscheduler [priority | fifo | sjf [size|remaining] | lottery | stride | mlfq [<aging>] | fairshare]"},
     {"clear", handle_clear, 0, 0, "clear"},
     {"ls", handle_view_directory, 0, 2, "ls <-l> <path>"},
     {"cd", handle_change_directory, 0, 1, "cd <path>"},
@@ -43,6 +56,7 @@ static const Command command_table[] = {
     {"changepassword", handle_change_password, 1, 1, "changepassword <username>"},
     {"addadmin", handle_add_admin, 1, 1, "addadmin <username>"},
     {"removeadmin", handle_remove_admin, 1, 1, "removeadmin <username>"},
+    {"login", handle_switch_user, 1, 1, "login <username>"},
     {NULL,        NULL, 0, 0, NULL} // Sentinel to mark end of command table
 };
 
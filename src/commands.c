@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 
 #include "color_library.h"
 #include "commands.h"
@@ -18,6 +19,18 @@
 #include "pcb.h"
 #include "queue.h"
 #include "auth.h"
+#include "engine.h"
+#include "parallel.h"
+#include "execpool.h"
+#include "waitchan.h"
+#include "scheduler.h"
+#include "edf.h"
+#include "owner.h"
+#include "schedstats.h"
+#include "acct.h"
+#include "timewheel.h"
+#include "image.h"
+#include "output.h"
 
 
 /**
@@ -29,6 +42,44 @@ static const char* const g_date_error_messages[] = {
     [DATE_ERROR_INVALID_DAY]   = "Invalid day for the given month and year."
 };
 
+/**
+ * @brief Parses a duration in milliseconds.
+ * @param str The string to parse.
+ * @param min Smallest accepted value.
+ * @param ms Receives the parsed value.
+ * @return 1 if str is an integer between min and WHEEL_MAX_DELAY, 0 otherwise.
+ */
+static int parse_ms(const char *str, const long min, unsigned int *ms) {
+    char *endptr;
+    errno = 0;
+    const long val = strtol(str, &endptr, 10);
+    if (*endptr != '\0' || endptr == str || errno != 0 || val < min || val > (long)WHEEL_MAX_DELAY) {
+        printf("%sError: Time must be an integer between %ld and %llu milliseconds.%s\n", RED, min,
+               (unsigned long long)WHEEL_MAX_DELAY, RESET);
+        return 0;
+    }
+    *ms = (unsigned int)val;
+    return 1;
+}
+
+/**
+ * @brief Parses the optional '--deadline <ms>' that may follow the fixed arguments of a command.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param first Index of the first optional argument.
+ * @param deadline_ms Receives the deadline, or 0 if none was given.
+ * @return 1 if the option is absent or valid, 0 otherwise.
+ */
+static int parse_deadline_option(const int argc, char *argv[], const int first, unsigned int *deadline_ms) {
+    *deadline_ms = 0;
+    if (argc <= first) return 1;
+    if (argc != first + 2 || strcmp(argv[first], "--deadline") != 0) {
+        printf("%sError: Expected '--deadline <ms>'.%s\n", RED, RESET);
+        return 0;
+    }
+    return parse_ms(argv[first + 1], 1, deadline_ms);
+}
+
 /**
  * @brief The 'help' command displays help information related to TechOS available commands.
  * @param argc Argument count.
@@ -146,13 +197,12 @@ void handle_terminate(const int argc, char *argv[]) {
  * @details Function will call setup_pcb and insert the PCB in the appropriate queue.
  * The command takes the process name, class, and priority as parameters.
  * The command should check that the name is unique and valid, the class is valid, and the priority is valid.
- * Otherwise, appropriate error messages should be given.
+ * Otherwise, appropriate error messages should be given. A system-class PCB may also be given a
+ * deadline with '--deadline <ms>', which schedules it ahead of application PCBs, earliest deadline first.
  * @param argc Argument count.
  * @param argv Argument vector.
  */
 void handle_create_pcb(const int argc, char *argv[]) {
-    (void)argc; // unused parameter
-
     /* validate name */
     char const *p_name = argv[1];
     if (!validate_name(p_name)) {
@@ -174,15 +224,29 @@ void handle_create_pcb(const int argc, char *argv[]) {
         return;
     }
 
+    /* validate deadline */
+    unsigned int deadline_ms;
+    if (!parse_deadline_option(argc, argv, 4, &deadline_ms)) {
+        return;
+    }
+    if (deadline_ms && p_class != 0) {
+        printf("%sError: Only system-class PCBs (class 0) can have a deadline.%s\n", RED, RESET);
+        return;
+    }
+
     if (find_pcb(p_name)) {
         printf("%sError: Name already in use.%s\n", RED, RESET); return;
     }
 
-    PCB const *p = setup_pcb(p_name, p_class, priority, "");
+    PCB const *p = setup_pcb(p_name, p_class, priority, NO_IMAGE, deadline_ms);
     if (!p) {
         printf("%sError: Could not allocate PCB.%s\n", RED, RESET); return;
     }
-    printf("%sPCB '%s' created (class=%u, priority=%d).%s\n", GREEN, p_name, p_class, priority, RESET);
+    if (deadline_ms) {
+        printf("%sPCB '%s' created (class=%u, priority=%d, deadline=%u ms).%s\n", GREEN, p_name, p_class, priority, deadline_ms, RESET);
+    } else {
+        printf("%sPCB '%s' created (class=%u, priority=%d).%s\n", GREEN, p_name, p_class, priority, RESET);
+    }
 }
 
 /**
@@ -216,6 +280,7 @@ void handle_delete_pcb(const int argc, char *argv[]) {
     }
 
     if (remove_pcb(p) == 0) {
+        free_pcb(p);
         printf("%sPCB '%s' deleted successfully.%s\n", GREEN, p_name, RESET);
     } else {
         printf("%sError: Could not delete PCB '%s'.%s\n", RED, p_name, RESET);
@@ -225,13 +290,17 @@ void handle_delete_pcb(const int argc, char *argv[]) {
 /**
  * @brief The 'blockpcb' command blocks a PCB by its name.
  * @details It searches for the PCB and moves it to the blocked queue if found.
- * It does not change the suspended status of the PCB.
+ * It does not change the suspended status of the PCB. With a time in milliseconds, the PCB is
+ * woken by the dispatcher once that time has passed.
  * @param argc Argument count.
  * @param argv Argument vector.
  */
 void handle_block_pcb(const int argc, char *argv[]) {
-    (void)argc; // unused parameter
     char const *p_name = argv[1];
+    unsigned int ms = 0;
+    if (argc > 2 && !parse_ms(argv[2], 1, &ms)) {
+        return;
+    }
 
     PCB *p = find_pcb(p_name);
     if (!p) {
@@ -251,6 +320,15 @@ void handle_block_pcb(const int argc, char *argv[]) {
 
     p->state = BLOCKED;
     insert_pcb(p);
+    if (ms > 0) {
+        if (waitchan_sleep(p, ms) != 0) {
+            printf("%sError: Could not set a wakeup deadline for '%s'. It stays blocked with no wakeup.%s\n", RED,
+                   p_name, RESET);
+        } else {
+            printf("%sPCB '%s' blocked successfully for %u ms.%s\n", GREEN, p_name, ms, RESET);
+        }
+        return;
+    }
     printf("%sPCB '%s' blocked successfully.%s\n", GREEN, p_name, RESET);
 }
 
@@ -278,6 +356,7 @@ void handle_unblock_pcb(const int argc, char *argv[]) {
         printf("%sError: Could not remove PCB '%s' from the blocked queue.%s\n", RED, p_name, RESET);
         return;
     }
+    waitchan_cancel(p);
     p->state = READY;
     insert_pcb(p);
     printf("%sPCB '%s' unblocked successfully.%s\n", GREEN, p_name, RESET);
@@ -389,9 +468,445 @@ void handle_show_pcb(const int argc, char *argv[]) {
     printf("State: %s\n", p->state==READY? "READY": p->state == RUNNING? "RUNNING" : "BLOCKED");
     printf("Suspended: %s\n", p->suspended? "true" : "false");
     printf("Priority: %d\n", p->priority);
+    const Owner *owner = owner_get(p->ext->owner);
+    if (owner) printf("Owner: %s (%s)\n", owner->name, owner_role_name(owner->role));
+    if (scheduler_get_policy() == SCHED_MLFQ) {
+        printf("MLFQ Level: %d\n", MLFQ_TOP_LEVEL - p->ext->depth);
+    }
+    const EdfInfo *edf = p->ext->edf;
+    if (edf) {
+        printf("Deadline: %u ms (%llu of %llu jobs missed)\n", edf->deadline_ms,
+               (unsigned long long)edf->stats.missed, (unsigned long long)edf->stats.jobs);
+    }
+    const ProcessImage *img = image_get(p->image);
+    if (img) {
+        printf("Image: %s\n", img->path);
+        printf("Offset: %lld of %lld\n", (long long)p->offset, (long long)img->size);
+    }
+    const OutputSink *sink = output_get(p->sink);
+    if (sink) {
+        printf("Output: %s%s%s (sink %u)\n", output_kind_name(sink->kind), sink->path ? " " : "",
+               sink->path ? sink->path : "", p->sink);
+    }
+    const long long remaining = waitchan_remaining(p);
+    if (remaining >= 0) {
+        printf("Wakeup: in %lld ms\n", remaining);
+    }
+    const ResourceUsage *usage = &p->ext->usage;
+    printf("Slices: %u\n", p->ext->slices);
+    printf("CPU Time: %.3f ms user, %.3f ms system\n", usage->utime_us / 1000.0, usage->stime_us / 1000.0);
+    if (usage->maxrss_kb) printf("Max RSS: %llu KiB\n", (unsigned long long)usage->maxrss_kb);
+    else printf("Max RSS: n/a\n");
+    printf("Context Switches: %llu voluntary, %llu involuntary\n", (unsigned long long)usage->nvcsw,
+           (unsigned long long)usage->nivcsw);
     printf("-----------------------------------------------\n");
 }
 
+/**
+ * @brief Prints the non-empty buckets of a lateness histogram on one line.
+ * @param stats The counters.
+ */
+static void print_lateness(const DeadlineStats *stats) {
+    if (stats->jobs == 0) return;
+    printf("    Lateness:");
+    for (int bucket = 0; bucket < LATENESS_BUCKETS; bucket++) {
+        if (stats->buckets[bucket]) {
+            printf(" %s %llu", edf_bucket_label(bucket), (unsigned long long)stats->buckets[bucket]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Prints a 'showdeadlines' row and its lateness histogram.
+ */
+static void print_deadline_row(const char *name, const char *state, const uint32_t deadline_ms, const DeadlineStats *stats) {
+    printf("%-8s  %-7s  %7u ms  %10llu  %10llu  %11.3f ms\n", name, state, deadline_ms, (unsigned long long)stats->jobs,
+           (unsigned long long)stats->missed, stats->worst_us / 1000.0);
+    print_lateness(stats);
+}
+
+/**
+ * @brief The 'showdeadlines' command reports how well PCBs with a deadline meet it.
+ * @details For every PCB with a deadline it shows the jobs finished, the deadlines missed, the worst
+ * lateness and a lateness histogram. PCBs that exist now come first, then the last EDF_KEEP_FINISHED
+ * that were freed, marked done. The totals of every job follow, including those of PCBs no longer listed.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_show_deadlines(const int argc, char *argv[]) {
+    (void)argc; (void)argv; // unused parameters
+
+    printf("--------------------------------- Deadlines ---------------------------------\n");
+    printf("%-8s  %-7s  %10s  %10s  %10s  %14s\n", "Name", "State", "Deadline", "Jobs", "Missed", "Worst late");
+    for (const EdfInfo *edf = edf_list(); edf; edf = edf->next) {
+        print_deadline_row(edf->pcb->p_name, edf->pcb->state == BLOCKED ? "blocked" : "ready", edf->deadline_ms,
+                           &edf->stats);
+    }
+    const EdfRecord *record;
+    for (size_t i = 0; (record = edf_finished(i)) != NULL; i++) {
+        print_deadline_row(record->p_name, "done", record->deadline_ms, &record->stats);
+    }
+    const DeadlineStats *totals = edf_totals();
+    printf("%-8s  %-7s  %10s  %10llu  %10llu  %11.3f ms\n", "All", "", "", (unsigned long long)totals->jobs,
+           (unsigned long long)totals->missed, totals->worst_us / 1000.0);
+    print_lateness(totals);
+    printf("------------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief The 'showusers' command reports how dispatch slices were shared among the users who created PCBs.
+ * @details Each user is listed with their role, fair-share weight, live PCBs, slices executed and share of
+ * all slices. The virtual runtime is in slices of weight 1 and only advances under the fairshare policy.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_show_users(const int argc, char *argv[]) {
+    (void)argc; (void)argv; // unused parameters
+
+    uint64_t total = 0;
+    for (OwnerId id = 1; id <= owner_count(); id++) {
+        total += owner_get(id)->slices;
+    }
+
+    printf("----------------------------------- Users ------------------------------------\n");
+    printf("%-16s  %-7s  %6s  %6s  %10s  %7s  %12s\n", "Name", "Role", "Weight", "PCBs", "Slices", "Share", "Vruntime");
+    for (OwnerId id = 1; id <= owner_count(); id++) {
+        const Owner *owner = owner_get(id);
+        printf("%-16s  %-7s  %6u  %6u  %10llu  %6.1f%%  %12.2f\n", owner->name, owner_role_name(owner->role),
+               owner_weight(owner), owner->pcbs, (unsigned long long)owner->slices,
+               total ? 100.0 * (double)owner->slices / (double)total : 0.0, (double)owner->vruntime / (double)FAIRSHARE_SLICE);
+    }
+    printf("------------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief Prints one metric of the scheduler statistics: a row for all PCBs, then one per priority and class that has values.
+ * @param metric The metric.
+ * @param title Heading of the metric.
+ * @param scale Divisor that converts recorded values to the unit displayed.
+ * @param decimals Decimals displayed.
+ */
+static void print_sched_metric(const SchedMetric metric, const char *title, const double scale, const int decimals) {
+    printf("%s\n", title);
+    printf("    %-9s %9s %10s %10s %10s %10s %10s\n", "Group", "Count", "Mean", "p50", "p90", "p99", "Max");
+    for (int group = 0; group < STATS_GROUPS; group++) {
+        const Histogram *h = schedstats_get(metric, group);
+        if (group != STATS_GROUP_ALL && h->count == 0) continue;
+
+        char label[16];
+        if (group == STATS_GROUP_ALL) {
+            snprintf(label, sizeof(label), "All");
+        } else if (group < STATS_GROUP_CLASS(0)) {
+            snprintf(label, sizeof(label), "Prio %d", group - STATS_GROUP_PRIORITY(0));
+        } else {
+            snprintf(label, sizeof(label), "Class %d", group - STATS_GROUP_CLASS(0));
+        }
+        const double mean = h->count ? (double)h->sum / (double)h->count : 0.0;
+        printf("    %-9s %9llu %10.*f %10.*f %10.*f %10.*f %10.*f\n", label, (unsigned long long)h->count,
+               decimals, mean / scale,
+               decimals, (double)histogram_percentile(h, 50.0) / scale,
+               decimals, (double)histogram_percentile(h, 90.0) / scale,
+               decimals, (double)histogram_percentile(h, 99.0) / scale,
+               decimals, (double)h->max / scale);
+    }
+}
+
+/**
+ * @brief The 'schedstats' command prints how long PCBs waited and ran under the dispatcher, or resets the counts.
+ * @details Wait time is measured per slice, from the moment a PCB joins the ready queue until it is
+ * dispatched. Response time runs from creation to the first slice, and turnaround from creation to
+ * completion or failure. Each metric is broken down by priority and by class.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_sched_stats(const int argc, char *argv[]) {
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            printf("%sUsage: schedstats [reset]%s\n", MAGENTA, RESET);
+            return;
+        }
+        schedstats_reset();
+        printf("%sScheduler statistics reset.%s\n", GREEN, RESET);
+        return;
+    }
+
+    printf("------------------------------ Scheduler Stats -------------------------------\n");
+    printf("Scheduler: %s, collected over %.3f s\n", scheduler_policy_name(scheduler_get_policy()), schedstats_elapsed());
+    print_sched_metric(STAT_WAIT, "Wait time per slice (ms):", 1000.0, 3);
+    print_sched_metric(STAT_RESPONSE, "Response time (ms):", 1000.0, 3);
+    print_sched_metric(STAT_TURNAROUND, "Turnaround time (ms):", 1000.0, 3);
+    print_sched_metric(STAT_SLICES, "Slices per PCB:", 1.0, 1);
+    printf("------------------------------------------------------------------------------\n");
+}
+
+/* A row of the 'toppcbs' report: a PCB that exists now or an accounting record of a finished one. */
+typedef struct {
+    const char *name;
+    const char *state;
+    uint32_t slices;
+    const ResourceUsage *usage;
+} TopRow;
+
+/* What 'toppcbs' ranks by, for its qsort comparators. */
+static bool g_top_by_memory = false;
+
+/**
+ * @brief qsort comparator ordering report rows from the largest to the smallest ranking value.
+ */
+static int compare_top_rows(const void *a, const void *b) {
+    const uint64_t ka = acct_key(((const TopRow *)a)->usage, g_top_by_memory);
+    const uint64_t kb = acct_key(((const TopRow *)b)->usage, g_top_by_memory);
+    return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/**
+ * @brief qsort comparator ordering image ids from the largest to the smallest ranking value.
+ */
+static int compare_top_images(const void *a, const void *b) {
+    const uint64_t ka = acct_key(&image_get(*(const ImageId *)a)->usage, g_top_by_memory);
+    const uint64_t kb = acct_key(&image_get(*(const ImageId *)b)->usage, g_top_by_memory);
+    return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/**
+ * @brief Prints the usage columns of a 'toppcbs' row. A resident set that was never measured reads n/a.
+ */
+static void print_usage_columns(const ResourceUsage *usage) {
+    char rss[24] = "n/a";
+    if (usage->maxrss_kb) snprintf(rss, sizeof(rss), "%llu", (unsigned long long)usage->maxrss_kb);
+    printf(" %9.3f %9.3f %9s %8llu %8llu\n", usage->utime_us / 1000.0, usage->stime_us / 1000.0, rss,
+           (unsigned long long)usage->nvcsw, (unsigned long long)usage->nivcsw);
+}
+
+/**
+ * @brief The 'toppcbs' command ranks PCBs and process images by the CPU time or memory their slices used.
+ * @details Usage is measured per slice: with getrusage() on the dispatching thread for in-process execution,
+ * with wait4() for an external executor and by the worker itself in the executor pool. Only the external
+ * executor's resident set belongs to one slice, so it is the only one recorded. PCBs that exist now are
+ * ranked along with the most expensive finished ones; images keep the usage of every PCB that ran them.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_top_pcbs(const int argc, char *argv[]) {
+    long limit = 10;
+    bool by_memory = false;
+    int arg = 1;
+    if (arg < argc && (strcmp(argv[arg], "cpu") == 0 || strcmp(argv[arg], "mem") == 0)) {
+        by_memory = strcmp(argv[arg], "mem") == 0;
+        arg++;
+    }
+    if (arg < argc) {
+        char *endptr;
+        errno = 0;
+        limit = strtol(argv[arg], &endptr, 10);
+        if (*endptr != '\0' || endptr == argv[arg] || errno != 0 || limit <= 0) limit = 0;
+        arg++;
+    }
+    if (arg < argc || limit == 0) {
+        printf("%sUsage: toppcbs [cpu|mem] [<count>]%s\n", MAGENTA, RESET);
+        return;
+    }
+
+    const Queue *queues[] = { &g_ready_queue, &g_blocked_queue, &g_suspended_ready_queue, &g_suspended_blocked_queue };
+    const int queue_count = (int)(sizeof(queues) / sizeof(queues[0]));
+    const AcctRecord *finished;
+    const size_t finished_count = acct_top(by_memory, &finished);
+    size_t capacity = finished_count;
+    for (int i = 0; i < queue_count; i++) capacity += (size_t)queues[i]->count;
+
+    TopRow *rows = malloc((capacity ? capacity : 1) * sizeof(TopRow));
+    ImageId *images = malloc((image_count() ? image_count() : 1) * sizeof(ImageId));
+    if (!rows || !images) {
+        printf("%sError: Out of memory.%s\n", RED, RESET);
+        free(rows);
+        free(images);
+        return;
+    }
+    size_t n = 0;
+    for (int i = 0; i < queue_count; i++) {
+        for (const PCB *p = queues[i]->head; p && n < capacity; p = p->next) {
+            rows[n++] = (TopRow){ p->p_name, p->state == BLOCKED ? "blocked" : "ready", p->ext->slices, &p->ext->usage };
+        }
+    }
+    for (size_t i = 0; i < finished_count; i++) {
+        rows[n++] = (TopRow){ finished[i].p_name, "done", finished[i].slices, &finished[i].usage };
+    }
+    for (ImageId id = 1; id <= image_count(); id++) images[id - 1] = id;
+    g_top_by_memory = by_memory;
+    qsort(rows, n, sizeof(TopRow), compare_top_rows);
+    qsort(images, image_count(), sizeof(ImageId), compare_top_images);
+
+    printf("---------------------------- Top PCBs by %-6s ------------------------------\n", by_memory ? "memory" : "CPU");
+    printf("%-8s  %-7s  %8s %9s %9s %9s %8s %8s\n", "PCB", "State", "Slices", "User ms", "Sys ms", "RSS KiB", "Vol csw", "Inv csw");
+    for (size_t i = 0; i < n && i < (size_t)limit; i++) {
+        printf("%-8s  %-7s  %8u", rows[i].name, rows[i].state, rows[i].slices);
+        print_usage_columns(rows[i].usage);
+    }
+    printf("%-27s %9s %9s %9s %8s %8s\n", "Image", "User ms", "Sys ms", "RSS KiB", "Vol csw", "Inv csw");
+    for (size_t i = 0; i < image_count() && i < (size_t)limit; i++) {
+        const ProcessImage *img = image_get(images[i]);
+        const char *base = strrchr(img->path, '/');
+        printf("%-27.27s", base ? base + 1 : img->path);
+        print_usage_columns(&img->usage);
+    }
+    printf("------------------------------------------------------------------------------\n");
+    free(rows);
+    free(images);
+}
+
+/**
+ * @brief The 'showimages' command lists every registered process image.
+ * @details Each image is opened and mapped once and shared by all PCBs that load it.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_show_images(const int argc, char *argv[]) {
+    (void)argc; (void)argv; // unused parameters
+
+    printf("------------------------------- Process Images -------------------------------\n");
+    for (ImageId id = 1; id <= image_count(); id++) {
+        const ProcessImage *img = image_get(id);
+        printf("[%u] %s (%lld bytes, %u PCB(s)", id, img->path, (long long)img->size, img->refs);
+        if (img->stream_fd != -1) printf(", streamed");
+        if (img->index.map) printf(", indexed: %llu interrupt(s)", (unsigned long long)img->index.count);
+        printf(")\n");
+    }
+    printf("------------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief The 'compileimage' command writes the interrupt index of a process image.
+ * @details The index lists every interrupt offset so that resuming a process is a binary search
+ * instead of a rescan. It is stored as "<file>.techos.idx" and is only used while the image keeps
+ * the size and modification time it was compiled for.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_compile_image(const int argc, char *argv[]) {
+    (void)argc; // unused parameter
+
+    char file_path[PATH_MAX];
+    if (!build_image_path(argv[1], file_path, sizeof(file_path)) || !validate_file_path(file_path)) {
+        return;
+    }
+
+    const long long count = imgindex_compile(file_path);
+    if (count < 0) {
+        printf("%sError: Could not compile index for '%s' --> %s%s\n", RED, file_path, strerror(errno), RESET);
+        return;
+    }
+    image_reindex(file_path);
+    printf("%sCompiled '%s%s' (%lld interrupt(s)).%s\n", GREEN, file_path, IMGINDEX_SUFFIX, count, RESET);
+}
+
+/**
+ * @brief The 'setpcboutput' command selects where a PCB's decoded output goes.
+ * @details Targets are 'none' (discard, the default), 'stdout', 'file <path>' and 'ring [<KiB>]'.
+ * PCBs writing to the same file share one sink. A ring keeps the most recent output in memory and
+ * can be read with 'showoutput' even after the PCB has finished.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_set_pcb_output(const int argc, char *argv[]) {
+    char const *p_name = argv[1];
+    char const *target = argv[2];
+
+    PCB *p = find_pcb(p_name);
+    if (!p) {
+        printf("%sError: PCB '%s' not found.%s\n", RED, p_name, RESET);
+        return;
+    }
+
+    SinkId sink;
+    if (strcmp(target, "none") == 0 && argc == 3) {
+        sink = NO_SINK;
+    } else if (strcmp(target, "stdout") == 0 && argc == 3) {
+        sink = output_open_stdout();
+        if (sink == NO_SINK) return;
+    } else if (strcmp(target, "file") == 0 && argc == 4) {
+        sink = output_open_file(argv[3]);
+        if (sink == NO_SINK) return;
+    } else if (strcmp(target, "ring") == 0) {
+        long kib = DEFAULT_RING_KIB;
+        if (argc == 4) {
+            char *endptr;
+            kib = strtol(argv[3], &endptr, 10);
+            if (*endptr != '\0' || kib < 1 || kib > 1024 * 1024) {
+                printf("%sError: Ring size must be between 1 and 1048576 KiB.%s\n", RED, RESET);
+                return;
+            }
+        }
+        sink = output_open_ring((size_t)kib * 1024);
+        if (sink == NO_SINK) return;
+    } else {
+        printf("%sError: Output must be 'none', 'stdout', 'file <path>' or 'ring [<KiB>]'.%s\n", RED, RESET);
+        return;
+    }
+
+    output_release(p->sink);
+    p->sink = sink;
+    if (sink == NO_SINK) {
+        printf("%sPCB '%s' output discarded.%s\n", GREEN, p_name, RESET);
+    } else {
+        printf("%sPCB '%s' output set to %s (sink %u).%s\n", GREEN, p_name,
+               output_kind_name(output_get(sink)->kind), sink, RESET);
+    }
+}
+
+/**
+ * @brief The 'showoutput' command lists the output sinks, or prints the contents of a ring sink.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_show_output(const int argc, char *argv[]) {
+    if (argc == 2) {
+        char *endptr;
+        const long id = strtol(argv[1], &endptr, 10);
+        const unsigned char *parts[2];
+        size_t lens[2];
+        if (*endptr != '\0' || id <= NO_SINK || id > MAX_OUTPUT_SINKS || !output_ring_read((SinkId)id, parts, lens)) {
+            printf("%sError: '%s' is not a ring sink with output.%s\n", RED, argv[1], RESET);
+            return;
+        }
+        fflush(stdout);
+        fwrite(parts[0], 1, lens[0], stdout);
+        fwrite(parts[1], 1, lens[1], stdout);
+        printf("\n");
+        return;
+    }
+
+    output_flush();
+    printf("-------------------------------- Output Sinks --------------------------------\n");
+    for (int id = STDOUT_SINK; id <= MAX_OUTPUT_SINKS; id++) {
+        const OutputSink *sink = output_get((SinkId)id);
+        if (!sink) continue;
+        printf("[%d] %s", id, output_kind_name(sink->kind));
+        if (sink->kind == SINK_FILE) printf(" %s", sink->path);
+        if (sink->kind == SINK_RING) printf(" (%zu of %zu bytes held)", sink->used, sink->capacity);
+        printf(": %llu byte(s) written, %u PCB(s)\n", sink->written, sink->refs);
+    }
+    printf("------------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief The 'showpcbpool' command displays the occupancy counters of the PCB pool.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_show_pcb_pool(const int argc, char *argv[]) {
+    (void)argc; (void)argv; // unused parameters
+    const Pool *pool = get_pcb_pool();
+
+    printf("--------------------------------- PCB Pool -----------------------------------\n");
+    printf("PCB Size: %zu bytes\n", pool->object_size);
+    printf("Slabs: %zu (%zu PCBs each)\n", pool->slab_count, pool->per_slab);
+    printf("Capacity: %zu\n", pool_capacity(pool));
+    printf("In Use: %zu\n", pool->in_use);
+    printf("High-Water Mark: %zu\n", pool->high_water);
+    printf("------------------------------------------------------------------------------\n");
+}
+
 /**
  * @brief The 'showreadypcbs' command displays all PCBs in the ready queue.
  * @details It retrieves and prints all PCBs that are currently in the ready state.
@@ -421,13 +936,11 @@ void handle_show_blocked_pcbs(const int argc, char *argv[]) {
 /**
  * @brief The 'loadpcbs' command loads a PCB from a file and adds it to the system.
  * @details It reads the PCB information from a file and creates a new PCB with the specified parameters.
+ * The PCB is an application PCB, unless '--deadline <ms>' is given: it is then a system PCB with that deadline.
  * @param argc Argument count.
  * @param argv Argument vector.
  */
 void handle_load_pcbs(const int argc, char *argv[]) {
-    (void)argc; // unused parameter
-    const int p_class = 1;
-
     /* validate name */
     char const *p_name = argv[1];
     if (!validate_name(p_name)) {
@@ -443,19 +956,30 @@ void handle_load_pcbs(const int argc, char *argv[]) {
     }
 
     /* validate file path */
-    char file_path_buffer[256];
-    snprintf(file_path_buffer, sizeof(file_path_buffer), "%s.techos", argv[3]);
-    char const *file_path = file_path_buffer;
-    if (!validate_file_path(file_path)) {
+    char file_path[PATH_MAX];
+    if (!build_image_path(argv[3], file_path, sizeof(file_path)) || !validate_file_path(file_path)) {
         return;
     }
 
+    /* validate deadline */
+    unsigned int deadline_ms;
+    if (!parse_deadline_option(argc, argv, 4, &deadline_ms)) {
+        return;
+    }
+    const int p_class = deadline_ms ? 0 : 1;
+
     if (find_pcb(p_name)) {
         printf("%sError: Name already in use.%s\n", RED, RESET); return;
     }
 
-    PCB const *p = setup_pcb(p_name, p_class, priority, file_path);
+    const ImageId image = image_register(file_path);
+    if (image == NO_IMAGE) {
+        return;
+    }
+
+    PCB const *p = setup_pcb(p_name, p_class, priority, image, deadline_ms);
     if (!p) {
+        image_release(image);
         printf("%sError: Could not allocate PCB.%s\n", RED, RESET); return;
     }
     printf("%sPCB '%s' created (class=%u, priority=%d, file_path=%s).%s\n", GREEN, p_name, p_class, priority, file_path, RESET);
@@ -464,12 +988,223 @@ void handle_load_pcbs(const int argc, char *argv[]) {
 /**
  * @brief The 'dispatchpcbs' command dispatches all PCBs in the ready queue.
  * @details It processes each PCB in the ready queue, executing them and handling their states.
+ * With "-w <workers>" slices run on that many worker threads; with "-k <children>" up to that many
+ * executors run at once and are reaped as they finish, or, with the pool engine, that many pool workers are used.
  * @param argc Argument count.
  * @param argv Argument vector.
  */
 void handle_dispatch_pcbs(const int argc, char *argv[]) {
-    (void)argc; (void)argv; // unused parameters
-    dispatch_all();
+    DispatchOptions options = { 1, 1 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            char *endptr;
+            const long val = strtol(argv[++i], &endptr, 10);
+            if (*endptr != '\0' || val < 1 || val > MAX_DISPATCH_WORKERS) {
+                printf("%sError: Worker count must be an integer between 1 and %d.%s\n", RED, MAX_DISPATCH_WORKERS, RESET);
+                return;
+            }
+            options.workers = (int)val;
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            char *endptr;
+            const long val = strtol(argv[++i], &endptr, 10);
+            if (*endptr != '\0' || val < 1 || val > MAX_DISPATCH_CHILDREN) {
+                printf("%sError: Children in flight must be an integer between 1 and %d.%s\n", RED, MAX_DISPATCH_CHILDREN, RESET);
+                return;
+            }
+            options.children = (int)val;
+        } else {
+            printf("%sError: Unknown option '%s'.%s\n", RED, argv[i], RESET);
+            printf("%sUsage: dispatchpcbs [-w <workers> | -k <children>]%s\n", MAGENTA, RESET);
+            return;
+        }
+    }
+
+    if (options.children > 1 && options.workers > 1) {
+        printf("%sError: '-w' and '-k' cannot be combined.%s\n", RED, RESET);
+        return;
+    }
+    if (options.children > 1 && engine_get_mode() == ENGINE_INPROC) {
+        printf("%sError: '-k' requires the external or pool engine. Use 'setengine external' or 'setengine pool' first.%s\n", RED, RESET);
+        return;
+    }
+    if (options.workers > 1 && engine_get_mode() == ENGINE_POOL) {
+        printf("%sError: '-w' cannot be used with the pool engine. Use '-k' to run pool workers at once.%s\n", RED, RESET);
+        return;
+    }
+    if (options.children > MAX_POOL_WORKERS && engine_get_mode() == ENGINE_POOL) {
+        printf("%sError: The pool engine runs at most %d workers.%s\n", RED, MAX_POOL_WORKERS, RESET);
+        return;
+    }
+
+    dispatch_all(&options);
+}
+
+/**
+ * @brief The 'setengine' command selects how the dispatcher executes time slices.
+ * @details Without arguments it displays the current mode. 'inproc' scans memory-mapped images inside TechOS,
+ * 'external' spawns the execute binary for every slice and 'pool' sends slices to long-lived execute workers.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_set_engine(const int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Current execution engine: %s\n", engine_mode_name(engine_get_mode()));
+        if (engine_get_mode() == ENGINE_POOL) {
+            printf("Pool workers running: %d (respawned: %lu)\n", execpool_size(), execpool_respawns());
+        }
+        return;
+    }
+
+    EngineMode mode;
+    if (!engine_parse_mode(argv[1], &mode)) {
+        printf("%sError: Engine must be 'inproc', 'external' or 'pool'.%s\n", RED, RESET);
+        return;
+    }
+
+    engine_set_mode(mode);
+    printf("%sExecution engine set to '%s'.%s\n", GREEN, engine_mode_name(mode), RESET);
+}
+
+/**
+ * @brief The 'setiolatency' command selects the service time of the simulated I/O a PCB starts when
+ * a slice is interrupted.
+ * @details Without arguments it displays the current distribution. With 'none' the I/O completes at
+ * once. Otherwise each interrupted PCB gets a wakeup deadline drawn from a fixed, uniform or
+ * exponential distribution, and PCBs are woken in deadline order.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_set_io_latency(const int argc, char *argv[]) {
+    if (argc < 2) {
+        const IoLatency *latency = waitchan_get_latency();
+        switch (latency->kind) {
+            case LATENCY_NONE: printf("I/O latency: none\n"); break;
+            case LATENCY_FIXED: printf("I/O latency: fixed %u ms\n", latency->min_ms); break;
+            case LATENCY_UNIFORM: printf("I/O latency: uniform %u-%u ms\n", latency->min_ms, latency->max_ms); break;
+            case LATENCY_EXP: printf("I/O latency: exponential, mean %u ms\n", latency->min_ms); break;
+        }
+        return;
+    }
+
+    IoLatency latency = { LATENCY_NONE, 0, 0 };
+    if (strcmp(argv[1], "none") == 0 && argc == 2) {
+        latency.kind = LATENCY_NONE;
+    } else if (strcmp(argv[1], "fixed") == 0 && argc == 3) {
+        if (!parse_ms(argv[2], 0, &latency.min_ms)) return;
+        latency.kind = LATENCY_FIXED;
+    } else if (strcmp(argv[1], "uniform") == 0 && argc == 4) {
+        if (!parse_ms(argv[2], 0, &latency.min_ms) || !parse_ms(argv[3], 0, &latency.max_ms)) return;
+        if (latency.max_ms < latency.min_ms) {
+            printf("%sError: The maximum must not be less than the minimum.%s\n", RED, RESET);
+            return;
+        }
+        latency.kind = LATENCY_UNIFORM;
+    } else if (strcmp(argv[1], "exp") == 0 && argc == 3) {
+        if (!parse_ms(argv[2], 1, &latency.min_ms)) return;
+        latency.kind = LATENCY_EXP;
+    } else {
+        printf("%sUsage: setiolatency [none | fixed <ms> | uniform <min> <max> | exp <mean>]%s\n", MAGENTA, RESET);
+        return;
+    }
+
+    waitchan_set_latency(&latency);
+    printf("%sI/O latency updated.%s\n", GREEN, RESET);
+}
+
+/**
+ * @brief The 'setquantum' command sets the quantum a time slice may run for before it is preempted.
+ * @details Without arguments it displays the current quantum. A byte quantum bounds how many bytes of
+ * the image one slice executes; a time quantum bounds how long it runs. A preempted PCB saves its offset
+ * and goes back to the tail of its priority level.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_set_quantum(const int argc, char *argv[]) {
+    if (argc < 2) {
+        const Quantum *quantum = engine_get_quantum();
+        switch (quantum->kind) {
+            case QUANTUM_NONE: printf("Time quantum: off\n"); break;
+            case QUANTUM_BYTES: printf("Time quantum: %llu bytes\n", quantum->amount); break;
+            case QUANTUM_MS: printf("Time quantum: %llu ms\n", quantum->amount); break;
+        }
+        return;
+    }
+
+    Quantum quantum = { QUANTUM_NONE, 0 };
+    if (strcmp(argv[1], "off") == 0 && argc == 2) {
+        quantum.kind = QUANTUM_NONE;
+    } else if (strcmp(argv[1], "bytes") == 0 && argc == 3) {
+        char *endptr;
+        errno = 0;
+        const unsigned long long bytes = strtoull(argv[2], &endptr, 10);
+        if (*endptr != '\0' || endptr == argv[2] || errno != 0 || bytes == 0 || argv[2][0] == '-') {
+            printf("%sError: The byte quantum must be a positive integer.%s\n", RED, RESET);
+            return;
+        }
+        quantum.kind = QUANTUM_BYTES;
+        quantum.amount = bytes;
+    } else if (strcmp(argv[1], "ms") == 0 && argc == 3) {
+        unsigned int ms;
+        if (!parse_ms(argv[2], 1, &ms)) return;
+        quantum.kind = QUANTUM_MS;
+        quantum.amount = ms;
+    } else {
+        printf("%sUsage: setquantum [off | bytes <n> | ms <n>]%s\n", MAGENTA, RESET);
+        return;
+    }
+
+    engine_set_quantum(&quantum);
+    printf("%sTime quantum updated.%s\n", GREEN, RESET);
+}
+
+/**
+ * @brief The 'setscheduler' command selects the policy that decides which ready PCB runs next.
+ * @details Without arguments it displays the current policy. 'sjf' takes an optional basis, 'size' for
+ * the image size or 'remaining' (default) for the bytes not executed yet. 'mlfq' takes an optional aging
+ * threshold in slices. PCBs already in the ready queue are filed under the new policy.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_set_scheduler(const int argc, char *argv[]) {
+    if (argc < 2) {
+        const SchedPolicyId id = scheduler_get_policy();
+        if (id == SCHED_SJF) {
+            printf("Current scheduler: sjf (%s)\n", scheduler_get_sjf_basis() == SJF_SIZE ? "image size" : "remaining bytes");
+        } else if (id == SCHED_MLFQ) {
+            printf("Current scheduler: mlfq (aging after %u slices)\n", scheduler_get_mlfq_aging());
+        } else {
+            printf("Current scheduler: %s\n", scheduler_policy_name(id));
+        }
+        return;
+    }
+
+    SchedPolicyId id;
+    if (!scheduler_parse_policy(argv[1], &id)) {
+        printf("%sError: Scheduler must be 'priority', 'fifo', 'sjf', 'lottery', 'stride', 'mlfq' or 'fairshare'.%s\n", RED, RESET);
+        return;
+    }
+    SjfBasis basis = SJF_REMAINING;
+    unsigned long aging = MLFQ_DEFAULT_AGING;
+    if (argc > 2 && id == SCHED_SJF && (strcmp(argv[2], "size") == 0 || strcmp(argv[2], "remaining") == 0)) {
+        basis = strcmp(argv[2], "size") == 0 ? SJF_SIZE : SJF_REMAINING;
+    } else if (argc > 2 && id == SCHED_MLFQ) {
+        char *endptr;
+        errno = 0;
+        aging = strtoul(argv[2], &endptr, 10);
+        if (*endptr != '\0' || endptr == argv[2] || errno != 0 || argv[2][0] == '-' || aging == 0 || aging > UINT32_MAX / 2) {
+            printf("%sError: The aging threshold must be a positive number of slices.%s\n", RED, RESET);
+            return;
+        }
+    } else if (argc > 2) {
+        printf("%sUsage: setscheduler [priority | fifo | sjf [size|remaining] | lottery | stride | mlfq [<aging>] | fairshare]%s\n", MAGENTA, RESET);
+        return;
+    }
+
+    scheduler_set_sjf_basis(basis);
+    scheduler_set_mlfq_aging((unsigned int)aging);
+    scheduler_set_policy(id);
+    printf("%sScheduler set to '%s'.%s\n", GREEN, scheduler_policy_name(id), RESET);
 }
 
 /**
@@ -1190,3 +1925,15 @@ void handle_remove_admin(const int argc, char *argv[]) {
 
     printf("%sUser '%s' no longer has administrator privileges.%s\n", GREEN, target_username, RESET);
 }
+
+/**
+ * @brief The 'login' command logs in as another user without leaving TechOS.
+ * @details PCBs created afterwards are owned by the new user. On a wrong password the current
+ * user stays logged in.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ */
+void handle_switch_user(const int argc, char *argv[]) {
+    (void)argc; // unused parameter
+    switch_user(argv[1]);
+}
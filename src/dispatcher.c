@@ -5,84 +5,462 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#else
+#include <poll.h>
+#endif
+#include "engine.h"
+#include "parallel.h"
+#include "execpool.h"
+#include "output.h"
+#include "waitchan.h"
+#include "scheduler.h"
+#include "schedstats.h"
 #include "color_library.h"
 
-void dispatch_all(void) {
+/**
+ * @brief Returns the elapsed time between two monotonic timestamps in seconds.
+ */
+static double elapsed_seconds(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
 
-    /* 1. Check if there are any processes in any queue before starting. */
-    if (!g_ready_queue.head && !g_blocked_queue.head && !g_suspended_ready_queue.head && !g_suspended_blocked_queue.head) {
-        printf("%sError: No processes to dispatch.%s\n", RED, RESET);
-        return;
+/**
+ * @brief Checks whether any of the four queues still holds a PCB.
+ */
+static bool queues_pending(void) {
+    return g_ready_queue.head || g_blocked_queue.head || g_suspended_ready_queue.head || g_suspended_blocked_queue.head;
+}
+
+/**
+ * @brief Wakeup phase: delivers the wakeups posted to the wait channels and the expired deadlines.
+ * @details When no PCB is ready and no slice is in flight, the dispatcher sleeps on the channels
+ * until a wakeup arrives or the next deadline passes, instead of polling. If neither a wakeup nor a
+ * deadline is pending at that point, a wakeup is posted for the oldest PCB of the first non-empty
+ * channel (blocked > suspended blocked > suspended ready) to prevent a stall.
+ * @param in_flight Number of slices currently running.
+ */
+static void wakeup_phase(const int in_flight) {
+    const bool idle = !g_ready_queue.head && in_flight == 0;
+    if (waitchan_pending() == 0 && waitchan_sleeping() == 0) {
+        if (!idle) return;
+        const Queue *parked[WAIT_CHANNELS] = { &g_blocked_queue, &g_suspended_blocked_queue, &g_suspended_ready_queue };
+        for (int id = 0; id < WAIT_CHANNELS; id++) {
+            if (!parked[id]->head) continue;
+            printf("%sDispatcher: Stall prevention, waking '%s'.%s\n", CYAN, parked[id]->head->p_name, RESET);
+            waitchan_post((WaitChannelId)id, 1);
+            break;
+        }
     }
+    waitchan_dispatch(idle ? -1 : 0);
+}
 
-    /* 2. Seed the random number generator for probabilistic unblocking. */
-    srand(time(NULL));
+/**
+ * @brief Sends the bytes a slice executed to the PCB's output sink.
+ * @details A slice runs from one byte past the saved offset up to, but not including, the next
+ * interrupt byte, or to the end of the image if the process completed.
+ * @param p Pointer to the PCB that ran, with its offset not yet advanced.
+ * @param next_offset Offset of the next interrupt, or 0 if the process completed.
+ */
+static void emit_output(const PCB *p, const off_t next_offset) {
+    const ProcessImage *img = image_get(p->image);
+    if (!img) return;
+    const off_t end = next_offset != 0 ? next_offset : img->size;
+    for (off_t pos = p->offset + 1; pos < end;) {
+        size_t len = (size_t)(end - pos);
+        const unsigned char *bytes = image_read(img, pos, &len);
+        if (!bytes || len == 0) return;
+        output_slice(p->sink, p->p_name, bytes, len);
+        pos += (off_t)len;
+    }
+}
 
-    /* 3. Loop until all four queues are empty. */
-    while (g_ready_queue.head || g_blocked_queue.head || g_suspended_ready_queue.head || g_suspended_blocked_queue.head) {
-        PCB *p_to_unblock = NULL;
+/**
+ * @brief Hints the kernel to read the region the next ready PCB will execute.
+ * @details Called once PCBs have been taken off the ready queue, so the read-ahead overlaps with
+ * the slices that are about to run.
+ */
+static void prefetch_next(void) {
+    const PCB *next = scheduler_pick_next();
+    if (!next) return;
+    const ProcessImage *img = image_get(next->image);
+    if (img) image_prefetch(img, next->offset + 1);
+}
 
-        /* --- UNBLOCKING PHASE --- */
+/**
+ * @brief Takes the PCB the scheduling policy picks off the ready queue to run a slice.
+ * @return Pointer to the PCB, now RUNNING. The ready queue must not be empty.
+ */
+static PCB *take_next(void) {
+    PCB *p = scheduler_pick_next();
+    remove_pcb(p);
+    p->state = RUNNING;
+    schedstats_on_dispatch(p);
+    return p;
+}
 
-        /* Find a candidate to unblock from any non-ready queue.
-         * Priority: Blocked > Suspended Blocked > Suspended Ready */
-        if (g_blocked_queue.head) {
-            p_to_unblock = g_blocked_queue.head;
-        } else if (g_suspended_blocked_queue.head) {
-            p_to_unblock = g_suspended_blocked_queue.head;
-        } else if (g_suspended_ready_queue.head) {
-            p_to_unblock = g_suspended_ready_queue.head;
-        }
+/**
+ * @brief Adds the resources a PCB's last slice used to the totals of the PCB and of its image.
+ */
+static void account_usage(PCB *p) {
+    resusage_add(&p->ext->usage, &p->ext->slice_usage);
+    image_charge(p->image, &p->ext->slice_usage);
+    memset(&p->ext->slice_usage, 0, sizeof(ResourceUsage));
+}
 
-        /* If a candidate for unblocking exists, decide whether to act. */
-        if (p_to_unblock) {
-            const bool must_unblock = !g_ready_queue.head;
-            const bool maybe_unblock = (g_ready_queue.head && (rand() % 2 == 0));
-
-            if (must_unblock || maybe_unblock) {
-                printf("%sDispatcher: %s unblocking '%s'.%s\n", CYAN, must_unblock ? "Stall prevention," : "Probabilistically", p_to_unblock->p_name, RESET);
-                remove_pcb(p_to_unblock);
-                p_to_unblock->state = READY;
-                p_to_unblock->suspended = false; // Always resume when unblocking
-                insert_pcb(p_to_unblock);
-
-                // If we had to unblock to prevent a stall, restart the loop
-                // to ensure the newly ready process is dispatched next.
-                if (must_unblock) {
-                    continue;
-                }
-            }
-        }
+/**
+ * @brief Applies the outcome of a time slice to a PCB.
+ * @details The slice's resource usage is accounted for and its output is emitted first. A completed or
+ * failed process is freed. An interrupted one saves its new offset, parks in the suspended-blocked queue
+ * and starts its simulated I/O, which completes at once or after a service time drawn by the wait channels. A preempted one
+ * saves the offset it stopped at and goes back to the ready queue. The scheduling policy is told
+ * about each outcome before the PCB is requeued or freed.
+ * @param p Pointer to the PCB that ran.
+ * @param status 0 if the slice executed, SLICE_PREEMPTED if it ran out of its quantum, -1 if it failed.
+ * @param next_offset Offset of the next interrupt, 0 if the process completed, or the offset to
+ * resume from if it was preempted.
+ */
+static void finish_slice(PCB *p, const int status, const off_t next_offset) {
+    account_usage(p);
+
+    if (status != -1 && p->sink != NO_SINK) {
+        emit_output(p, next_offset);
+    }
+
+    if (status != -1) {
+        scheduler_on_tick(p, status == SLICE_PREEMPTED);
+    }
+
+    if (status == SLICE_PREEMPTED) {
+        p->offset = next_offset - 1; // the next slice starts at the first byte not yet executed
+        p->state = READY;
+        p->suspended = false;
+        insert_pcb(p);
+        printf("%sDispatcher: Process '%s' preempted. New offset: %lld.%s\n", CYAN, p->p_name, (long long)p->offset, RESET);
+    } else if (status != 0) {
+        printf("%sDispatcher: Process '%s' failed and was terminated.%s\n", RED, p->p_name, RESET);
+        schedstats_on_exit(p);
+        scheduler_on_complete(p);
+        free_pcb(p);
+    } else if (next_offset == 0) {
+        printf("%sDispatcher: Process '%s' completed successfully.%s\n", GREEN, p->p_name, RESET);
+        schedstats_on_exit(p);
+        scheduler_on_complete(p);
+        free_pcb(p);
+    } else {
+        p->offset = next_offset;
+        p->state = BLOCKED;
+        p->suspended = true;
+        scheduler_on_block(p);
+        insert_pcb(p); // This will place it in the suspended-blocked queue
+        printf("%sDispatcher: Process '%s' interrupted. New offset: %lld.%s\n", MAGENTA, p->p_name, (long long)p->offset, RESET);
+        waitchan_start_io(p);
+    }
+}
+
+/**
+ * @brief Dispatches on the calling thread, running one slice at a time.
+ * @return Number of slices executed.
+ */
+static unsigned long dispatch_serial(void) {
+    unsigned long slices = 0;
+
+    /* Loop until all four queues are empty. */
+    while (queues_pending()) {
+
+        /* --- WAKEUP PHASE --- */
+        wakeup_phase(0);
 
         /* --- DISPATCHING PHASE --- */
 
         /* If nothing is ready to run, continue to the next loop iteration.
-         * This happens if probabilistic unblocking was possible but didn't happen. */
+         * This happens if the delivered wakeups had no parked PCB left to wake. */
         if (!g_ready_queue.head) {
             continue;
         }
 
-        PCB *p_to_run = g_ready_queue.head;
-        remove_pcb(p_to_run);
-        p_to_run->state = RUNNING;
-
-        printf("%sDispatcher: Running '%s' (offset: %d)...%s\n", YELLOW, p_to_run->p_name, p_to_run->offset, RESET);
-
-        char cmd[PATH_MAX + 32];
-        snprintf(cmd, sizeof(cmd), "./execute %s %d", p_to_run->file_path, p_to_run->offset + 1);
-        const int ret = system(cmd);
-
-        if (ret == 0) {
-            printf("%sDispatcher: Process '%s' completed successfully.%s\n", GREEN, p_to_run->p_name, RESET);
-            free_pcb(p_to_run);
-        } else {
-            p_to_run->offset = ret / 256;
-            p_to_run->state = BLOCKED;
-            p_to_run->suspended = true;
-            insert_pcb(p_to_run); // This will place it in the suspended-blocked queue
-            printf("%sDispatcher: Process '%s' interrupted. New offset: %d.%s\n", MAGENTA, p_to_run->p_name, p_to_run->offset, RESET);
+        PCB *p_to_run = take_next();
+        prefetch_next();
+
+        printf("%sDispatcher: Running '%s' (offset: %lld)...%s\n", YELLOW, p_to_run->p_name, (long long)p_to_run->offset, RESET);
+
+        off_t next_offset;
+        const int status = engine_run_slice(p_to_run, &next_offset);
+        slices++;
+        finish_slice(p_to_run, status, next_offset);
+    }
+    return slices;
+}
+
+/* Something that runs slices off the calling thread: the worker threads or the executor pool. */
+typedef struct {
+    int (*capacity)(void);               // slices that may be in flight at once
+    void (*submit)(PCB *p);              // starts a slice; the PCB must not be in any queue
+    void (*wait)(SliceResult *result);   // blocks until a slice finishes
+} AsyncExecutor;
+
+static const AsyncExecutor g_thread_executor = { parallel_capacity, parallel_submit, parallel_wait };
+static const AsyncExecutor g_pool_executor = { execpool_capacity, execpool_submit, execpool_wait };
+
+/**
+ * @brief Dispatches across worker threads or pool workers.
+ * @details The calling thread keeps sole ownership of the global queues. It feeds ready PCBs to the
+ * executor in priority order, keeping only as many slices in flight as the executor can take,
+ * and applies each result as it comes back.
+ * @param executor The executor that runs the slices.
+ * @return Number of slices executed.
+ */
+static unsigned long dispatch_async(const AsyncExecutor *executor) {
+    unsigned long slices = 0;
+    int in_flight = 0;
+
+    while (queues_pending() || in_flight > 0) {
+        if (queues_pending()) {
+            wakeup_phase(in_flight);
+        }
+
+        while (g_ready_queue.head && in_flight < executor->capacity()) {
+            PCB *p_to_run = take_next();
+            executor->submit(p_to_run);
+            in_flight++;
+        }
+        prefetch_next();
+
+        if (in_flight == 0) {
+            /* A ready PCB left over means the executor has no capacity, e.g. a pool whose workers
+             * could not be respawned. Fail what is ready rather than wait for capacity that never comes. */
+            while (g_ready_queue.head) {
+                slices++;
+                finish_slice(take_next(), -1, 0);
+            }
+            continue;
+        }
+
+        SliceResult result;
+        executor->wait(&result);
+        in_flight--;
+        slices++;
+        finish_slice(result.p, result.status, result.next_offset);
+    }
+    return slices;
+}
+
+/* A child executor that is currently running a slice. */
+typedef struct {
+    PCB *p;              // NULL if the slot is free
+    ExternalSlice slice;
+    int pidfd;           // pidfd of the child, or -1 if the result pipe is watched instead
+} ChildSlot;
+
+/**
+ * @brief Opens a pidfd for a child so its exit can be waited on with epoll.
+ * @param pid The child's process id.
+ * @return The pidfd, or -1 if pidfds are not available.
+ */
+static int open_pidfd(const pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Launches a ready PCB in a free child slot.
+ * @param slots The slot array.
+ * @param max_children Number of slots.
+ * @param p Pointer to the PCB to run. It must already be removed from the ready queue.
+ * @return The slot the child runs in, or NULL if the executor could not be spawned.
+ */
+static ChildSlot *launch_child(ChildSlot *slots, const int max_children, PCB *p) {
+    ChildSlot *slot = slots;
+    while (slot < slots + max_children && slot->p) slot++;
+
+    printf("%sDispatcher: Running '%s' (offset: %lld)...%s\n", YELLOW, p->p_name, (long long)p->offset, RESET);
+    if (engine_spawn_external(p, &slot->slice) != 0) {
+        return NULL;
+    }
+    slot->p = p;
+    slot->pidfd = open_pidfd(slot->slice.pid);
+    return slot;
+}
+
+/**
+ * @brief Reaps a finished child, frees its slot and applies the slice outcome.
+ * @param slot The slot whose child has exited.
+ */
+static void reap_child(ChildSlot *slot) {
+    PCB *p = slot->p;
+    off_t next_offset = 0;
+    const int status = engine_collect_external(p, &slot->slice, &next_offset);
+    if (slot->pidfd != -1) close(slot->pidfd);
+    slot->p = NULL;
+    slot->pidfd = -1;
+    finish_slice(p, status, next_offset);
+}
+
+/**
+ * @brief Dispatches with up to max_children executors running at once on the calling thread.
+ * @details Each child is watched through a pidfd (or its result pipe where pidfds are unavailable) in a
+ * single epoll set, and its PCB is re-inserted as soon as that child finishes. The queues are still only
+ * touched by this thread.
+ * @param max_children Maximum number of executors in flight.
+ * @return Number of slices executed.
+ */
+static unsigned long dispatch_concurrent(const int max_children) {
+    unsigned long slices = 0;
+    int in_flight = 0;
+
+    ChildSlot *slots = calloc((size_t)max_children, sizeof(ChildSlot));
+#ifdef __linux__
+    struct epoll_event *events = calloc((size_t)max_children, sizeof(struct epoll_event));
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (!slots || !events || epfd == -1) {
+        printf("%sDispatcher: Could not set up child supervision --> %s%s\n", RED, strerror(errno), RESET);
+        free(slots);
+        free(events);
+        if (epfd != -1) close(epfd);
+        return dispatch_serial();
+    }
+#else
+    struct pollfd *pfds = calloc((size_t)max_children, sizeof(struct pollfd));
+    if (!slots || !pfds) {
+        free(slots);
+        free(pfds);
+        return dispatch_serial();
+    }
+#endif
+
+    while (queues_pending() || in_flight > 0) {
+        if (queues_pending()) {
+            wakeup_phase(in_flight);
+        }
+
+        while (g_ready_queue.head && in_flight < max_children) {
+            PCB *p_to_run = take_next();
+
+            ChildSlot *slot = launch_child(slots, max_children, p_to_run);
+            if (!slot) {
+                slices++;
+                finish_slice(p_to_run, -1, 0);
+                continue;
+            }
+            in_flight++;
+#ifdef __linux__
+            struct epoll_event ev = { .events = EPOLLIN, .data.ptr = slot };
+            epoll_ctl(epfd, EPOLL_CTL_ADD, slot->pidfd != -1 ? slot->pidfd : slot->slice.result_fd, &ev);
+#endif
+        }
+        prefetch_next();
+
+        if (in_flight == 0) {
+            continue;
+        }
+
+#ifdef __linux__
+        const int n = epoll_wait(epfd, events, max_children, -1);
+        for (int i = 0; i < n; i++) {
+            ChildSlot *slot = events[i].data.ptr;
+            epoll_ctl(epfd, EPOLL_CTL_DEL, slot->pidfd != -1 ? slot->pidfd : slot->slice.result_fd, NULL);
+            reap_child(slot);
+            in_flight--;
+            slices++;
+        }
+#else
+        int nfds = 0;
+        for (int i = 0; i < max_children; i++) {
+            if (slots[i].p) pfds[nfds++] = (struct pollfd){ .fd = slots[i].slice.result_fd, .events = POLLIN };
         }
+        if (poll(pfds, (nfds_t)nfds, -1) > 0) {
+            for (int i = 0; i < max_children; i++) {
+                if (!slots[i].p) continue;
+                for (int j = 0; j < nfds; j++) {
+                    if (pfds[j].fd == slots[i].slice.result_fd && pfds[j].revents) {
+                        reap_child(&slots[i]);
+                        in_flight--;
+                        slices++;
+                        break;
+                    }
+                }
+            }
+        }
+#endif
+    }
+
+#ifdef __linux__
+    close(epfd);
+    free(events);
+#else
+    free(pfds);
+#endif
+    free(slots);
+    return slices;
+}
+
+/**
+ * @brief Runs every PCB in the system until all four queues are empty.
+ * @param options Dispatch options (worker count, children in flight).
+ */
+void dispatch_all(const DispatchOptions *options) {
+
+    /* 1. Check if there are any processes in any queue before starting. */
+    if (!queues_pending()) {
+        printf("%sError: No processes to dispatch.%s\n", RED, RESET);
+        return;
     }
 
+    /* 2. Reload the images of files that were truncated or replaced since their PCBs were loaded. */
+    image_revalidate();
+
+    /* 3. Open the wait channels blocked PCBs sleep on. */
+    if (waitchan_open() != 0) {
+        printf("%sDispatcher: Could not create wait channels --> %s%s\n", RED, strerror(errno), RESET);
+        return;
+    }
+
+    int workers = options->workers;
+    if (workers > 1 && parallel_start(workers) != 0) {
+        printf("%sDispatcher: Could not start %d workers, dispatching serially.%s\n", YELLOW, workers, RESET);
+        workers = 1;
+    }
+    if (options->children > 1 && engine_get_mode() == ENGINE_POOL && execpool_start(options->children) != 0) {
+        printf("%sDispatcher: Could not start the executor pool.%s\n", RED, RESET);
+        waitchan_close();
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* 4. Loop until all four queues are empty. */
+    unsigned long slices;
+    if (options->children > 1 && engine_get_mode() == ENGINE_POOL) {
+        slices = dispatch_async(&g_pool_executor);
+    } else if (options->children > 1) {
+        slices = dispatch_concurrent(options->children);
+    } else if (workers > 1) {
+        slices = dispatch_async(&g_thread_executor);
+        parallel_stop();
+    } else {
+        slices = dispatch_serial();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    waitchan_close();
+    output_flush();
+    const double seconds = elapsed_seconds(&start, &end);
     printf("%sDispatcher: All processes have finished execution.%s\n", GREEN, RESET);
+    if (options->children > 1) {
+        printf("%sDispatcher: %lu slices in %.3f s (%.0f slices/s) with up to %d children in flight.%s\n", MAGENTA, slices,
+               seconds, seconds > 0 ? (double)slices / seconds : 0.0, options->children, RESET);
+    } else {
+        printf("%sDispatcher: %lu slices in %.3f s (%.0f slices/s) across %d worker(s).%s\n", MAGENTA, slices, seconds,
+               seconds > 0 ? (double)slices / seconds : 0.0, workers, RESET);
+    }
 }
@@ -0,0 +1,201 @@
+#include "edf.h"
+#include <string.h>
+#include "pool.h"
+#include "queue.h"
+#include "pcbheap.h"
+#include "utils.h"
+
+/* Number of EdfInfo records carved from each slab. */
+#define EDF_PER_SLAB 64
+
+static Pool g_edf_pool;
+static bool g_edf_pool_ready = false;
+
+/* Ready PCBs with a deadline, earliest absolute deadline first. */
+static PCBHeap g_edf_heap;
+
+static EdfInfo *g_head = NULL;
+static EdfInfo *g_tail = NULL;
+
+/* The last EDF_KEEP_FINISHED PCBs with a deadline that were freed, in a ring; g_finished_next is the oldest once it is full. */
+static EdfRecord g_finished[EDF_KEEP_FINISHED];
+static size_t g_finished_count = 0;
+static size_t g_finished_next = 0;
+
+/* Jobs of every PCB that ever had a deadline, including PCBs that are gone. */
+static DeadlineStats g_totals;
+
+static const char *const g_bucket_labels[LATENESS_BUCKETS] = {
+    "on time", "<1 ms", "<2 ms", "<4 ms", "<8 ms", "<16 ms", "<32 ms", "<64 ms",
+    "<128 ms", "<256 ms", "<512 ms", "<1024 ms", ">=1024 ms"
+};
+
+/**
+ * @brief Returns the lateness histogram bucket of a job.
+ * @param late_us How late the job finished in microseconds, 0 if it was on time.
+ */
+static int lateness_bucket(const uint64_t late_us) {
+    if (late_us == 0) return 0;
+    const uint64_t ms = late_us / 1000;
+    if (ms == 0) return 1;
+    const int bucket = 2 + (63 - __builtin_clzll(ms));
+    return bucket < LATENESS_BUCKETS ? bucket : LATENESS_BUCKETS - 1;
+}
+
+/**
+ * @brief Adds a finished job to a set of counters.
+ */
+static void record_job(DeadlineStats *stats, const uint64_t late_us) {
+    stats->jobs++;
+    if (late_us > 0) stats->missed++;
+    if (late_us > stats->worst_us) stats->worst_us = late_us;
+    stats->buckets[lateness_bucket(late_us)]++;
+}
+
+/**
+ * @brief Gives a PCB a deadline. Must be called before the PCB is inserted in a queue.
+ * @param p Pointer to a system-class PCB.
+ * @param deadline_ms Relative deadline of each of its jobs, in milliseconds.
+ * @return 0 on success, -1 if the record could not be allocated.
+ */
+int edf_attach(PCB *p, const unsigned int deadline_ms) {
+    if (!g_edf_pool_ready) {
+        pool_init(&g_edf_pool, sizeof(EdfInfo), 0, EDF_PER_SLAB);
+        g_edf_pool_ready = true;
+    }
+    EdfInfo *info = pool_alloc(&g_edf_pool);
+    if (!info) return -1;
+
+    info->pcb = p;
+    info->deadline_ms = deadline_ms;
+    info->prev = g_tail;
+    if (g_tail) g_tail->next = info; else g_head = info;
+    g_tail = info;
+    p->ext->edf = info;
+    return 0;
+}
+
+/**
+ * @brief Drops the deadline of a PCB that is being freed.
+ * @details Its counters are kept as a finished record, replacing the oldest one when EDF_KEEP_FINISHED
+ * are kept, and its finished jobs stay in the totals.
+ * @param p Pointer to the PCB. Nothing happens if it has no deadline.
+ */
+void edf_detach(PCB *p) {
+    EdfInfo *info = p->ext->edf;
+    if (!info) return;
+    pcbheap_remove(&g_edf_heap, p);
+
+    EdfRecord *record = &g_finished[g_finished_next];
+    memcpy(record->p_name, p->p_name, sizeof(record->p_name));
+    record->deadline_ms = info->deadline_ms;
+    record->stats = info->stats;
+    g_finished_next = (g_finished_next + 1) % EDF_KEEP_FINISHED;
+    if (g_finished_count < EDF_KEEP_FINISHED) g_finished_count++;
+
+    if (info->prev) info->prev->next = info->next; else g_head = info->next;
+    if (info->next) info->next->prev = info->prev; else g_tail = info->prev;
+    pool_free(&g_edf_pool, info);
+    p->ext->edf = NULL;
+}
+
+/**
+ * @brief Files a ready PCB with a deadline, releasing a new job if none is pending.
+ * @details The PCB goes to the real-time level of the ready queue, above every priority, and into
+ * the EDF heap under its absolute deadline.
+ * @param p Pointer to the PCB.
+ */
+void edf_enqueue(PCB *p) {
+    EdfInfo *info = p->ext->edf;
+    if (info->due_us == 0) info->due_us = monotonic_us() + (uint64_t)info->deadline_ms * 1000ULL;
+    queue_push_level(&g_ready_queue, p, REALTIME_LEVEL);
+    pcbheap_push(&g_edf_heap, p, info->due_us);
+}
+
+/**
+ * @brief Takes a PCB with a deadline out of the ready queue. Its pending job stays due.
+ * @param p Pointer to the PCB.
+ */
+void edf_remove(PCB *p) {
+    pcbheap_remove(&g_edf_heap, p);
+    dequeue(&g_ready_queue, p);
+}
+
+/**
+ * @brief Returns the ready PCB with the earliest deadline.
+ * @details Falls back to the oldest PCB of the real-time level if the heap could not grow.
+ * @return Pointer to the PCB, or NULL if no PCB with a deadline is ready.
+ */
+PCB *edf_pick_next(void) {
+    PCB *p = pcbheap_top(&g_edf_heap);
+    return p ? p : g_ready_queue.level_head[REALTIME_LEVEL];
+}
+
+/**
+ * @brief Empties the EDF heap, for the scheduler to file every ready PCB again.
+ */
+void edf_clear_ready(void) {
+    pcbheap_clear(&g_edf_heap);
+}
+
+/**
+ * @brief Ends the current job of a PCB when its slice was not preempted, and records its lateness.
+ * @param p Pointer to the PCB.
+ * @param preempted Whether the slice ran out of its quantum.
+ */
+void edf_on_tick(PCB *p, const bool preempted) {
+    EdfInfo *info = p->ext->edf;
+    if (preempted || info->due_us == 0) return;
+
+    const uint64_t now = monotonic_us();
+    const uint64_t late_us = now > info->due_us ? now - info->due_us : 0;
+    record_job(&info->stats, late_us);
+    record_job(&g_totals, late_us);
+    info->due_us = 0;
+}
+
+/**
+ * @brief Returns the first PCB with a deadline; the others follow through next.
+ */
+const EdfInfo *edf_list(void) {
+    return g_head;
+}
+
+/**
+ * @brief Returns a kept record of a freed PCB with a deadline.
+ * @param i Index of the record, 0 for the oldest kept.
+ * @return Pointer to the record, or NULL if fewer than i + 1 records are kept.
+ */
+const EdfRecord *edf_finished(const size_t i) {
+    if (i >= g_finished_count) return NULL;
+    const size_t oldest = g_finished_count < EDF_KEEP_FINISHED ? 0 : g_finished_next;
+    return &g_finished[(oldest + i) % EDF_KEEP_FINISHED];
+}
+
+/**
+ * @brief Returns the counters of every job finished so far, including those of PCBs that are gone.
+ */
+const DeadlineStats *edf_totals(void) {
+    return &g_totals;
+}
+
+/**
+ * @brief Returns the label of a lateness histogram bucket.
+ */
+const char *edf_bucket_label(const int bucket) {
+    return bucket >= 0 && bucket < LATENESS_BUCKETS ? g_bucket_labels[bucket] : "?";
+}
+
+/**
+ * @brief Drops every deadline and the EDF heap.
+ * @details cleanup_techos() calls it after scheduler_cleanup() and before cleanup_pcbs(). The deadline
+ * records are pooled and freed here in one go, not with their PCBs.
+ */
+void edf_cleanup(void) {
+    pcbheap_clear(&g_edf_heap);
+    if (g_edf_pool_ready) pool_reset(&g_edf_pool);
+    g_head = g_tail = NULL;
+    g_finished_count = 0;
+    g_finished_next = 0;
+    memset(&g_totals, 0, sizeof(g_totals));
+}
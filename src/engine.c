@@ -0,0 +1,323 @@
+#ifdef __linux__
+#define _GNU_SOURCE // pipe2
+#endif
+#include "engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "image.h"
+#include "execpool.h"
+#include "utils.h"
+#include "color_library.h"
+
+extern char **environ;
+
+/* getrusage() target that covers only the calling thread where the system has one, so worker threads
+ * running slices side by side are not charged for each other. */
+#ifdef RUSAGE_THREAD
+#define SLICE_RUSAGE RUSAGE_THREAD
+#else
+#define SLICE_RUSAGE RUSAGE_SELF
+#endif
+
+static EngineMode g_engine_mode = ENGINE_INPROC;
+static Quantum g_quantum = { QUANTUM_NONE, 0 };
+
+/**
+ * @brief Selects how subsequent time slices are executed.
+ * @details Leaving the pool mode stops the pool's workers.
+ * @param mode The execution mode.
+ */
+void engine_set_mode(const EngineMode mode) {
+    if (mode != ENGINE_POOL) execpool_stop();
+    g_engine_mode = mode;
+}
+
+/**
+ * @brief Gets the current execution mode.
+ * @return The current EngineMode.
+ */
+EngineMode engine_get_mode(void) {
+    return g_engine_mode;
+}
+
+/**
+ * @brief Converts an execution mode to its command-line name.
+ * @param mode The execution mode.
+ * @return "inproc", "external" or "pool".
+ */
+const char *engine_mode_name(const EngineMode mode) {
+    switch (mode) {
+        case ENGINE_INPROC: return "inproc";
+        case ENGINE_EXTERNAL: return "external";
+        case ENGINE_POOL: return "pool";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Parses an execution mode name.
+ * @param str The string to parse ("inproc", "external" or "pool").
+ * @param mode Pointer to store the parsed mode.
+ * @return 1 if valid, 0 otherwise.
+ */
+int engine_parse_mode(const char *str, EngineMode *mode) {
+    if (strcmp(str, "inproc") == 0) {
+        *mode = ENGINE_INPROC;
+        return 1;
+    }
+    if (strcmp(str, "external") == 0) {
+        *mode = ENGINE_EXTERNAL;
+        return 1;
+    }
+    if (strcmp(str, "pool") == 0) {
+        *mode = ENGINE_POOL;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sets the quantum that limits every subsequent slice.
+ * @param quantum The quantum.
+ */
+void engine_set_quantum(const Quantum *quantum) {
+    g_quantum = *quantum;
+}
+
+/**
+ * @brief Gets the current quantum.
+ * @return Pointer to the quantum, valid until the next engine_set_quantum().
+ */
+const Quantum *engine_get_quantum(void) {
+    return &g_quantum;
+}
+
+/**
+ * @brief Creates the pipe used to receive the executor's result, with close-on-exec set on both ends.
+ * @param fds Receives the read and write descriptors.
+ * @return 0 on success, -1 on failure.
+ */
+static int open_result_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) == -1) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+/**
+ * @brief Reads the offset reported by the executor until the pipe is closed.
+ * @details The executor writes "<offset>" when it stopped at an interrupt or completed, and
+ * "preempt <offset>" when it used up its quantum.
+ * @param fd Read end of the result pipe.
+ * @param next_offset Receives the parsed offset.
+ * @return 0 if a well-formed offset was read, SLICE_PREEMPTED if it was a preemption, -1 otherwise.
+ */
+static int read_result(const int fd, off_t *next_offset) {
+    char buf[32];
+    size_t len = 0;
+    for (;;) {
+        const ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+        if (n == 0) break;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        len += (size_t)n;
+        if (len == sizeof(buf) - 1) break;
+    }
+    buf[len] = '\0';
+
+    static const char preempt_prefix[] = "preempt ";
+    const bool preempted = strncmp(buf, preempt_prefix, sizeof(preempt_prefix) - 1) == 0;
+    const char *number = preempted ? buf + sizeof(preempt_prefix) - 1 : buf;
+
+    char *endptr;
+    errno = 0;
+    const long long val = strtoll(number, &endptr, 10);
+    if (len == 0 || endptr == number || *endptr != '\n' || errno != 0 || val < 0) {
+        return -1;
+    }
+    *next_offset = (off_t)val;
+    return preempted ? SLICE_PREEMPTED : 0;
+}
+
+/**
+ * @brief Starts the external executor for one slice without waiting for it.
+ * @details The executor is started with posix_spawn and an argv array, so no shell is
+ * involved and file paths containing spaces or shell metacharacters are passed through untouched.
+ * The executor reports the offset it stopped at as a decimal line on EXECUTOR_RESULT_FD, so offsets are
+ * not limited to the 8 bits of an exit status. The current quantum is passed along and enforced by the executor.
+ * @param p Pointer to the PCB to run. Execution starts one byte past its saved offset.
+ * @param slice Receives the child's pid and the read end of its result pipe.
+ * @return 0 on success, -1 if the executor could not be spawned.
+ */
+int engine_spawn_external(const PCB *p, ExternalSlice *slice) {
+    const ProcessImage *img = image_get(p->image);
+    if (!img) {
+        printf("%sEngine: Process '%s' has no process image.%s\n", RED, p->p_name, RESET);
+        return -1;
+    }
+
+    char offset_arg[32];
+    char fd_arg[16];
+    char bytes_arg[32];
+    char ms_arg[32];
+    snprintf(offset_arg, sizeof(offset_arg), "%lld", (long long)(p->offset + 1));
+    snprintf(fd_arg, sizeof(fd_arg), "%d", EXECUTOR_RESULT_FD);
+    snprintf(bytes_arg, sizeof(bytes_arg), "%llu", g_quantum.kind == QUANTUM_BYTES ? g_quantum.amount : 0);
+    snprintf(ms_arg, sizeof(ms_arg), "%llu", g_quantum.kind == QUANTUM_MS ? g_quantum.amount : 0);
+
+    char *const argv[] = { EXECUTOR_PATH, img->path, offset_arg, fd_arg, bytes_arg, ms_arg, NULL };
+
+    int fds[2];
+    if (open_result_pipe(fds) == -1) {
+        printf("%sEngine: Could not create result pipe --> %s%s\n", RED, strerror(errno), RESET);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], EXECUTOR_RESULT_FD);
+
+    const int err = posix_spawn(&slice->pid, EXECUTOR_PATH, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (err != 0) {
+        printf("%sEngine: Could not spawn '%s' --> %s%s\n", RED, EXECUTOR_PATH, strerror(err), RESET);
+        close(fds[0]);
+        return -1;
+    }
+
+    slice->result_fd = fds[0];
+    return 0;
+}
+
+/**
+ * @brief Reads the result of a spawned executor and reaps it.
+ * @details Blocks until the executor exits if it is still running. The executor's resource usage,
+ * returned by wait4(), is stored as the PCB's slice usage.
+ * @param p Pointer to the PCB that ran.
+ * @param slice The slice returned by engine_spawn_external(). Its result descriptor is closed.
+ * @param next_offset Receives the offset reported by the executor.
+ * @return 0 if the executor exited normally with a result, SLICE_PREEMPTED if it reported a
+ * preemption, -1 otherwise.
+ */
+int engine_collect_external(PCB *p, ExternalSlice *slice, off_t *next_offset) {
+    const int result = read_result(slice->result_fd, next_offset);
+    const int have_result = result != -1;
+    close(slice->result_fd);
+    slice->result_fd = -1;
+
+    int status;
+    struct rusage usage;
+    while (wait4(slice->pid, &status, 0, &usage) == -1) {
+        if (errno != EINTR) {
+            printf("%sEngine: wait4 failed for '%s' --> %s%s\n", RED, p->p_name, strerror(errno), RESET);
+            return -1;
+        }
+    }
+    resusage_between(NULL, &usage, &p->ext->slice_usage);
+
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status) == 0 && have_result ? result : -1;
+    }
+    if (WIFSIGNALED(status)) {
+        printf("%sEngine: Process '%s' killed by signal %d.%s\n", RED, p->p_name, WTERMSIG(status), RESET);
+    }
+    return -1;
+}
+
+/**
+ * @brief Runs an in-process slice under the current quantum.
+ * @details A byte quantum bounds the scan directly. A time quantum is checked between chunks of
+ * IMAGE_CHUNK_BYTES, so a slice overruns it by at most one chunk scan.
+ * @param img The image.
+ * @param start Offset the slice starts at.
+ * @param next_offset Receives the interrupt offset, 0 on completion, or where execution resumes when preempted.
+ * @return 0 on success, SLICE_PREEMPTED if the quantum ran out, -1 on a read error.
+ */
+static int run_inproc(const ProcessImage *img, const off_t start, off_t *next_offset) {
+    off_t end = img->size;
+    if (g_quantum.kind == QUANTUM_BYTES && g_quantum.amount < (unsigned long long)(img->size - start)) {
+        end = start + (off_t)g_quantum.amount;
+    }
+
+    off_t step = end - start;
+    uint64_t deadline = 0;
+    if (g_quantum.kind == QUANTUM_MS && !img->index.map) { // an index lookup never outlasts a quantum
+        step = IMAGE_CHUNK_BYTES;
+        deadline = monotonic_us() + g_quantum.amount * 1000ULL;
+    }
+
+    for (off_t pos = start; pos < end; pos += step) {
+        const off_t stop = end - pos > step ? pos + step : end;
+        if (image_next_interrupt(img, pos, stop, next_offset) != 0) return -1;
+        if (*next_offset != 0) return 0;
+        if (deadline && stop < end && monotonic_us() >= deadline) {
+            *next_offset = stop;
+            return SLICE_PREEMPTED;
+        }
+    }
+    if (end < img->size) {
+        *next_offset = end;
+        return SLICE_PREEMPTED;
+    }
+    *next_offset = 0;
+    return 0;
+}
+
+/**
+ * @brief Runs one time slice of a process using the current execution mode.
+ * @details Execution starts one byte past the PCB's saved offset, skipping the interrupt byte it stopped at.
+ * The resources the slice used are stored in the PCB's slice usage for the dispatcher to account for.
+ * @param p Pointer to the PCB to run.
+ * @param next_offset Receives the offset of the next interrupt, or 0 if the process completed. When the
+ * slice is preempted, receives the offset execution resumes from.
+ * @return 0 on success, SLICE_PREEMPTED if the quantum ran out, -1 if the slice could not be executed.
+ */
+int engine_run_slice(PCB *p, off_t *next_offset) {
+    const ProcessImage *img = image_get(p->image);
+    if (!img) {
+        printf("%sEngine: Process '%s' has no process image.%s\n", RED, p->p_name, RESET);
+        return -1;
+    }
+    if (g_engine_mode == ENGINE_EXTERNAL) {
+        ExternalSlice slice;
+        if (engine_spawn_external(p, &slice) != 0) return -1;
+        return engine_collect_external(p, &slice, next_offset);
+    }
+    if (g_engine_mode == ENGINE_POOL) {
+        return execpool_run(p, next_offset);
+    }
+    if (img->stale) {
+        printf("%sEngine: Process image '%s' changed on disk and could not be reloaded.%s\n", RED, img->path, RESET);
+        return -1;
+    }
+    struct rusage before, after;
+    struct timespec cpu_before, cpu_after;
+    getrusage(SLICE_RUSAGE, &before);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_before);
+    const int status = run_inproc(img, p->offset + 1, next_offset);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_after);
+    getrusage(SLICE_RUSAGE, &after);
+    resusage_between(&before, &after, &p->ext->slice_usage);
+    resusage_set_cpu(&p->ext->slice_usage, (uint64_t)((cpu_after.tv_sec - cpu_before.tv_sec) * 1000000LL +
+                                                      (cpu_after.tv_nsec - cpu_before.tv_nsec) / 1000));
+    if (status == -1) {
+        printf("%sEngine: Could not read process image '%s' --> %s%s\n", RED, img->path, strerror(errno), RESET);
+    }
+    return status;
+}
@@ -0,0 +1,371 @@
+#include "execpool.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "engine.h"
+#include "execproto.h"
+#include "image.h"
+#include "color_library.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+extern char **environ;
+
+/* A long-lived executor process, started with 'execute --serve'. */
+typedef struct {
+    pid_t pid; // 0 if the slot has no running worker
+    int fd;    // TechOS end of the socket shared with the worker
+    PCB *job;  // PCB whose slice the worker is running, NULL if idle
+} PoolWorker;
+
+static PoolWorker g_workers[MAX_POOL_WORKERS];
+static int g_worker_count = 0;        // slots that have been started, running or not
+static int g_active = 0;              // slots the current dispatch may use
+static unsigned long g_respawns = 0;
+
+/* Slices that failed before reaching a worker, returned by the next execpool_wait(). */
+static SliceResult g_failed[MAX_POOL_WORKERS];
+static int g_failed_count = 0;
+
+/**
+ * @brief Starts the executor for a pool slot.
+ * @details The worker gets its end of a stream socket as EXECUTOR_RESULT_FD and receives jobs and
+ * sends replies on it (see execproto.h). Both ends are close-on-exec, so no other child inherits them.
+ * @param slot Index of the slot to start.
+ * @return 0 on success, -1 if the worker could not be started.
+ */
+static int spawn_worker(const int slot) {
+    PoolWorker *w = &g_workers[slot];
+    int sv[2];
+#ifdef SOCK_CLOEXEC
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1) {
+#else
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+#endif
+        printf("%sEngine: Could not create a pool socket --> %s%s\n", RED, strerror(errno), RESET);
+        return -1;
+    }
+#ifndef SOCK_CLOEXEC
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    fcntl(sv[1], F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    char fd_arg[16];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", EXECUTOR_RESULT_FD);
+    char *const argv[] = { EXECUTOR_PATH, EXECUTOR_SERVE_FLAG, fd_arg, NULL };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, sv[1], EXECUTOR_RESULT_FD);
+
+    const int err = posix_spawn(&w->pid, EXECUTOR_PATH, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(sv[1]);
+    if (err != 0) {
+        printf("%sEngine: Could not spawn '%s' --> %s%s\n", RED, EXECUTOR_PATH, strerror(err), RESET);
+        close(sv[0]);
+        w->pid = 0;
+        return -1;
+    }
+    w->fd = sv[0];
+    w->job = NULL;
+    return 0;
+}
+
+/**
+ * @brief Shuts down a worker and reaps it.
+ * @param w The worker.
+ * @param force Kill the worker instead of letting it exit once its socket is closed.
+ * @return The worker's wait status, or -1 if it could not be reaped.
+ */
+static int reap_worker(PoolWorker *w, const bool force) {
+    close(w->fd);
+    w->fd = -1;
+    if (force) kill(w->pid, SIGKILL);
+
+    int status;
+    while (waitpid(w->pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            status = -1;
+            break;
+        }
+    }
+    w->pid = 0;
+    return status;
+}
+
+/**
+ * @brief Replaces a worker that crashed or broke the protocol.
+ * @details The worker is killed if still running, then a fresh one is started in its slot. If that
+ * fails, the slot stays empty and the pool runs with one worker less.
+ * @param slot Index of the worker's slot.
+ */
+static void respawn_worker(const int slot) {
+    PoolWorker *w = &g_workers[slot];
+    const pid_t pid = w->pid;
+    const int status = reap_worker(w, true);
+    if (status != -1 && WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) {
+        printf("%sEngine: Pool worker %d (pid %d) killed by signal %d, respawning.%s\n", RED, slot, (int)pid, WTERMSIG(status), RESET);
+    } else {
+        printf("%sEngine: Pool worker %d (pid %d) terminated, respawning.%s\n", RED, slot, (int)pid, RESET);
+    }
+    g_respawns++;
+    spawn_worker(slot);
+}
+
+/**
+ * @brief Sends the job for a PCB's next slice to a worker.
+ * @param w The worker.
+ * @param path Path of the PCB's process image.
+ * @param offset Offset to start the slice at.
+ * @return 0 on success, -1 if the worker's socket is broken.
+ */
+static int send_job(const PoolWorker *w, const char *path, const off_t offset) {
+    char frame[sizeof(ExecJob) + PATH_MAX];
+    const size_t path_len = strlen(path);
+    const Quantum *quantum = engine_get_quantum();
+    const ExecJob job = {
+        (int64_t)offset,
+        quantum->kind == QUANTUM_BYTES ? (uint64_t)quantum->amount : 0,
+        quantum->kind == QUANTUM_MS ? (uint32_t)quantum->amount : 0,
+        (uint32_t)path_len,
+    };
+    memcpy(frame, &job, sizeof(job));
+    memcpy(frame + sizeof(job), path, path_len);
+
+    const size_t len = sizeof(job) + path_len;
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t n = send(w->fd, frame + done, len - done, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads a worker's reply to its current job.
+ * @param w The worker.
+ * @param reply Receives the reply.
+ * @return 0 on success, -1 if the worker exited or sent a truncated reply.
+ */
+static int recv_reply(const PoolWorker *w, ExecReply *reply) {
+    size_t got = 0;
+    while (got < sizeof(*reply)) {
+        const ssize_t n = recv(w->fd, (char *)reply + got, sizeof(*reply) - got, 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Hands a PCB's slice to the worker in a slot, respawning the worker once if it is gone.
+ * @param slot Index of an idle worker's slot.
+ * @param p Pointer to the PCB.
+ * @return 0 on success, -1 if the slice could not be started.
+ */
+static int start_job(const int slot, const PCB *p) {
+    const ProcessImage *img = image_get(p->image);
+    if (!img) {
+        printf("%sEngine: Process '%s' has no process image.%s\n", RED, p->p_name, RESET);
+        return -1;
+    }
+    if (strlen(img->path) >= PATH_MAX) {
+        printf("%sEngine: Image path of '%s' is too long for the pool.%s\n", RED, p->p_name, RESET);
+        return -1;
+    }
+
+    PoolWorker *w = &g_workers[slot];
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (w->pid != 0 && send_job(w, img->path, p->offset + 1) == 0) {
+            return 0;
+        }
+        if (w->pid != 0) {
+            respawn_worker(slot);
+        } else if (spawn_worker(slot) != 0) {
+            break;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Completes the job a worker is running and stores the resources it reported as the PCB's slice usage.
+ * @param slot Index of the worker's slot.
+ * @param p Pointer to the PCB whose slice the worker is running.
+ * @param next_offset Receives the offset the worker reported.
+ * @return 0 on success, SLICE_PREEMPTED if the slice ran out of its quantum, -1 if the worker could
+ * not run the slice or crashed (it is then respawned).
+ */
+static int finish_job(const int slot, PCB *p, off_t *next_offset) {
+    PoolWorker *w = &g_workers[slot];
+
+    ExecReply reply;
+    if (recv_reply(w, &reply) != 0) {
+        printf("%sEngine: Pool worker %d was lost while running '%s'.%s\n", RED, slot, p->p_name, RESET);
+        respawn_worker(slot);
+        return -1;
+    }
+    if (reply.next_offset < 0) {
+        printf("%sEngine: Pool worker %d could not read the process image of '%s'.%s\n", RED, slot, p->p_name, RESET);
+        return -1;
+    }
+    p->ext->slice_usage = (ResourceUsage){ reply.utime_us, reply.stime_us, reply.maxrss_kb, reply.nvcsw, reply.nivcsw };
+    *next_offset = (off_t)reply.next_offset;
+    return reply.preempted ? SLICE_PREEMPTED : 0;
+}
+
+/**
+ * @brief Makes sure at least the given number of workers are running and uses that many.
+ * @details Workers are kept running between dispatches, so only missing ones are started. Slots whose
+ * worker could not be respawned earlier are retried.
+ * @param workers Number of workers to use (1 to MAX_POOL_WORKERS).
+ * @return 0 on success, -1 if no worker could be started.
+ */
+int execpool_start(const int workers) {
+    for (int i = 0; i < workers; i++) {
+        if (g_workers[i].pid == 0) spawn_worker(i);
+    }
+    if (workers > g_worker_count) g_worker_count = workers;
+    g_active = workers;
+    g_failed_count = 0;
+    return execpool_capacity() > 0 ? 0 : -1;
+}
+
+/**
+ * @brief Returns the number of slices that may be in flight at once: one per running worker in use.
+ */
+int execpool_capacity(void) {
+    int running = 0;
+    for (int i = 0; i < g_active; i++) {
+        if (g_workers[i].pid != 0) running++;
+    }
+    return running;
+}
+
+/**
+ * @brief Returns the number of workers currently running, including idle ones beyond the last dispatch.
+ */
+int execpool_size(void) {
+    int running = 0;
+    for (int i = 0; i < g_worker_count; i++) {
+        if (g_workers[i].pid != 0) running++;
+    }
+    return running;
+}
+
+/**
+ * @brief Returns how many workers have been respawned since TechOS started.
+ */
+unsigned long execpool_respawns(void) {
+    return g_respawns;
+}
+
+/**
+ * @brief Hands a PCB to an idle worker.
+ * @details If the slice cannot be started, its failure is returned by the next execpool_wait().
+ * @param p Pointer to the PCB. It must not be in any global queue, and fewer than
+ * execpool_capacity() slices may be in flight.
+ */
+void execpool_submit(PCB *p) {
+    int slot = 0;
+    while (slot < g_active && (g_workers[slot].pid == 0 || g_workers[slot].job)) slot++;
+
+    if (slot < g_active) {
+        printf("%sDispatcher[%d]: Running '%s' (offset: %lld)...%s\n", YELLOW, slot, p->p_name, (long long)p->offset, RESET);
+        if (start_job(slot, p) == 0) {
+            g_workers[slot].job = p;
+            return;
+        }
+    }
+    g_failed[g_failed_count++] = (SliceResult){ p, -1, 0, slot };
+}
+
+/**
+ * @brief Blocks until a worker finishes a slice.
+ * @details Busy workers are watched with poll(). A worker that exits mid-slice fails that slice and
+ * is respawned.
+ * @param result Receives the outcome of the slice.
+ */
+void execpool_wait(SliceResult *result) {
+    if (g_failed_count > 0) {
+        *result = g_failed[--g_failed_count];
+        return;
+    }
+
+    struct pollfd pfds[MAX_POOL_WORKERS];
+    int slots[MAX_POOL_WORKERS];
+    for (;;) {
+        int nfds = 0;
+        for (int i = 0; i < g_worker_count; i++) {
+            if (!g_workers[i].job) continue;
+            pfds[nfds] = (struct pollfd){ .fd = g_workers[i].fd, .events = POLLIN };
+            slots[nfds++] = i;
+        }
+        if (poll(pfds, (nfds_t)nfds, -1) == -1) {
+            if (errno == EINTR) continue;
+            printf("%sEngine: poll failed --> %s%s\n", RED, strerror(errno), RESET);
+            pfds[0].revents = POLLIN; // fall back to a blocking read of the first busy worker
+        }
+        for (int i = 0; i < nfds; i++) {
+            if (!pfds[i].revents) continue;
+            const int slot = slots[i];
+            PCB *p = g_workers[slot].job;
+            g_workers[slot].job = NULL;
+            result->p = p;
+            result->worker = slot;
+            result->next_offset = 0;
+            result->status = finish_job(slot, p, &result->next_offset);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Runs one slice on the pool and waits for it.
+ * @details Starts the pool with a single worker if it is not running yet.
+ * @param p Pointer to the PCB to run. Execution starts one byte past its saved offset.
+ * @param next_offset Receives the offset of the next interrupt, or 0 if the process completed.
+ * @return 0 on success, SLICE_PREEMPTED if the slice was preempted, -1 if the slice could not be executed.
+ */
+int execpool_run(PCB *p, off_t *next_offset) {
+    if (g_active == 0 && execpool_start(1) != 0) return -1;
+
+    int slot = 0;
+    while (slot < g_active && g_workers[slot].pid == 0) slot++;
+    if (slot == g_active) slot = 0; // every worker is gone, start_job() respawns this one
+
+    if (start_job(slot, p) != 0) return -1;
+    return finish_job(slot, p, next_offset);
+}
+
+/**
+ * @brief Stops every worker.
+ * @details Closing a worker's socket makes it exit once its current job is done.
+ */
+void execpool_stop(void) {
+    for (int i = 0; i < g_worker_count; i++) {
+        if (g_workers[i].pid != 0) reap_worker(&g_workers[i], false);
+        g_workers[i].job = NULL;
+    }
+    g_worker_count = 0;
+    g_active = 0;
+    g_failed_count = 0;
+}
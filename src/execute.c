@@ -1,34 +1,348 @@
-#include <stdio.h>
-#include <unistd.h>
-#include <stdlib.h>
-#include <sys/types.h>
-#include <string.h>
-#include <assert.h>
-
-int main(int argc, char *argv[])
-{
-	FILE *inp;
-	int c;
-	int offset = atoi(argv[2]);
-	int counter = offset;
-	char ch = '!';
-
-	inp = fopen(argv[1], "r");
-	if (!inp) {
-		perror("Error opening process file.");
-		return 1;
-	}
-
-	fseek(inp, offset, SEEK_SET);
-	c = fgetc(inp);
-	while (c != EOF && c - 5 != (int)ch)
-	{
-		//printf("Read %c\n", c - 5);
-		counter++;
-		c = fgetc(inp);
-	}
-	if (c == EOF)
-		return 0;
-	else
-		return counter;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include "imgindex.h"
+#include "scan.h"
+#include "execproto.h"
+#include "resusage.h"
+
+/* Bytes of the image read and scanned per step. Reads start on a multiple of this size. */
+#define READ_CHUNK (1024 * 1024)
+
+/* Images a pool worker keeps open between jobs. */
+#define SERVE_CACHE_SIZE 16
+
+/* An image kept open by a pool worker. */
+typedef struct {
+    char path[PATH_MAX]; // empty if the entry is unused
+    int fd;
+    struct stat st;      // status of the file when it was opened
+    ImageStamp stamp;    // version of the file when it was opened
+    ImageIndex index;    // index.map is NULL if the image has no valid index
+} OpenImage;
+
+/* Returned by run_slice() when the slice used up its quantum. */
+#define PREEMPTED 1
+
+static unsigned char buffer[READ_CHUNK];
+
+#ifdef __linux__
+static int quantum_fd = -1; // timerfd measuring the time quantum, created on first use
+#else
+static struct timespec quantum_deadline;
+#endif
+
+/**
+ * @brief Starts measuring a time quantum.
+ * @details Uses a timerfd where available; re-arming it also clears an expiry left over from the
+ * previous slice. Elsewhere the deadline is remembered and compared against the monotonic clock.
+ */
+static void quantum_start(const unsigned int ms)
+{
+#ifdef __linux__
+	if (quantum_fd == -1)
+		quantum_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	const struct itimerspec its = { { 0, 0 }, { ms / 1000, (long)(ms % 1000) * 1000000L } };
+	timerfd_settime(quantum_fd, 0, &its, NULL);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &quantum_deadline);
+	quantum_deadline.tv_sec += ms / 1000;
+	quantum_deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+	if (quantum_deadline.tv_nsec >= 1000000000L) {
+		quantum_deadline.tv_sec++;
+		quantum_deadline.tv_nsec -= 1000000000L;
+	}
+#endif
+}
+
+/**
+ * @brief Checks whether the time quantum started by quantum_start() has run out.
+ */
+static bool quantum_expired(void)
+{
+#ifdef __linux__
+	uint64_t expirations;
+	return quantum_fd == -1 || read(quantum_fd, &expirations, sizeof(expirations)) == sizeof(expirations);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec > quantum_deadline.tv_sec ||
+	       (now.tv_sec == quantum_deadline.tv_sec && now.tv_nsec >= quantum_deadline.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Runs one slice: finds the next interrupt at or after an offset, within the quantum.
+ * @details Uses the interrupt index when one is given; otherwise the image is read with pread()
+ * in large aligned chunks, with sequential read-ahead advised. A time quantum is checked between chunks.
+ * @param fd Descriptor of the image.
+ * @param index Valid interrupt index of the image, or NULL.
+ * @param size Size of the image.
+ * @param offset Offset to start from.
+ * @param max_bytes Byte quantum, 0 for none.
+ * @param quantum_ms Time quantum, 0 for none.
+ * @param counter Receives the offset of the interrupt byte, 0 if the image ran to completion, or the
+ * offset to resume from if the slice was preempted.
+ * @return 0 on success, PREEMPTED if the quantum ran out, -1 on a read error.
+ */
+static int run_slice(const int fd, const ImageIndex *index, const off_t size, const off_t offset,
+		     const unsigned long long max_bytes, const unsigned int quantum_ms, off_t *counter)
+{
+	off_t end = size;
+	if (max_bytes && offset < size && max_bytes < (unsigned long long)(size - offset))
+		end = offset + (off_t)max_bytes;
+
+	*counter = 0;
+	if (index) {
+		const off_t next = imgindex_next(index, offset);
+		if (next && next < end) {
+			*counter = next;
+			return 0;
+		}
+	} else {
+		if (quantum_ms)
+			quantum_start(quantum_ms);
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		off_t pos = offset - offset % READ_CHUNK;
+		size_t skip = (size_t)(offset - pos); // bytes before offset in the first chunk
+		while (pos < end) {
+			ssize_t n = pread(fd, buffer, sizeof(buffer), pos);
+			if (n == -1 && errno == EINTR)
+				continue;
+			if (n == -1)
+				return -1;
+			if (n > end - pos)
+				n = (ssize_t)(end - pos);
+			if ((size_t)n <= skip)
+				break; // ran to completion
+			const unsigned char *hit = scan_interrupt(buffer + skip, (size_t)n - skip);
+			if (hit) {
+				*counter = pos + (hit - buffer);
+				return 0;
+			}
+			pos += n;
+			skip = 0;
+			if (quantum_ms && pos < end && quantum_expired()) {
+				*counter = pos;
+				return PREEMPTED;
+			}
+		}
+	}
+
+	if (end < size) {
+		*counter = end;
+		return PREEMPTED;
+	}
+	return 0;
+}
+
+/**
+ * @brief Reads exactly len bytes.
+ * @return 1 on success, 0 at end of stream before any byte, -1 on error or a truncated read.
+ */
+static int read_full(const int fd, void *buf, const size_t len)
+{
+	size_t got = 0;
+	while (got < len) {
+		const ssize_t n = read(fd, (char *)buf + got, len - got);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return n == 0 && got == 0 ? 0 : -1;
+		got += (size_t)n;
+	}
+	return 1;
+}
+
+/**
+ * @brief Writes exactly len bytes.
+ * @return 0 on success, -1 on error.
+ */
+static int write_full(const int fd, const void *buf, const size_t len)
+{
+	size_t done = 0;
+	while (done < len) {
+		const ssize_t n = write(fd, (const char *)buf + done, len - done);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return -1;
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+/**
+ * @brief Gets an open image from the worker's cache, (re)opening it if needed.
+ * @details The path is stat'ed on every job so a replaced or modified file is reopened and its
+ * index revalidated. When the cache is full, the entries are reused round-robin.
+ * @return The cache entry, or NULL if the image cannot be opened.
+ */
+static OpenImage *open_cached(OpenImage *cache, const char *path)
+{
+	static int next_victim = 0;
+	struct stat st;
+	if (stat(path, &st) == -1)
+		return NULL;
+	ImageStamp stamp;
+	imgindex_stamp(&st, &stamp);
+
+	OpenImage *entry = NULL;
+	for (int i = 0; i < SERVE_CACHE_SIZE && !entry; i++) {
+		if (strcmp(cache[i].path, path) == 0)
+			entry = &cache[i];
+	}
+	if (entry && entry->st.st_dev == st.st_dev && imgindex_stamp_equal(&entry->stamp, &stamp))
+		return entry;
+
+	if (!entry) {
+		entry = &cache[next_victim];
+		next_victim = (next_victim + 1) % SERVE_CACHE_SIZE;
+	}
+	if (entry->path[0] != '\0') {
+		close(entry->fd);
+		imgindex_close(&entry->index);
+		entry->path[0] = '\0';
+	}
+
+	entry->fd = open(path, O_RDONLY);
+	if (entry->fd == -1 || fstat(entry->fd, &entry->st) == -1) {
+		if (entry->fd != -1)
+			close(entry->fd);
+		return NULL;
+	}
+	imgindex_stamp(&entry->st, &entry->stamp);
+	imgindex_open(path, &entry->stamp, &entry->index);
+	strcpy(entry->path, path);
+	return entry;
+}
+
+/**
+ * @brief Pool worker: runs slices for TechOS until the connection is closed.
+ * @param fd Connected socket shared with TechOS.
+ * @return Exit status: 0 when TechOS closes the connection, 1 on a protocol error.
+ */
+static int serve(const int fd)
+{
+	static OpenImage cache[SERVE_CACHE_SIZE];
+	char path[PATH_MAX];
+
+	for (;;) {
+		ExecJob job;
+		const int r = read_full(fd, &job, sizeof(job));
+		if (r == 0)
+			return 0;
+		if (r < 0 || job.path_len == 0 || job.path_len >= sizeof(path) || job.offset < 0 ||
+		    read_full(fd, path, job.path_len) != 1)
+			return 1;
+		path[job.path_len] = '\0';
+
+		ExecReply reply = { .next_offset = -1 };
+		struct rusage before, after;
+		struct timespec cpu_before, cpu_after;
+		getrusage(RUSAGE_SELF, &before);
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_before);
+		OpenImage *img = open_cached(cache, path);
+		off_t counter;
+		const int status = img ? run_slice(img->fd, img->index.map ? &img->index : NULL, img->st.st_size,
+						   (off_t)job.offset, job.max_bytes, job.quantum_ms, &counter) : -1;
+		if (status != -1) {
+			reply.next_offset = (int64_t)counter;
+			reply.preempted = status == PREEMPTED;
+		}
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_after);
+		getrusage(RUSAGE_SELF, &after);
+		ResourceUsage usage;
+		resusage_between(&before, &after, &usage);
+		resusage_set_cpu(&usage, (uint64_t)((cpu_after.tv_sec - cpu_before.tv_sec) * 1000000LL +
+						    (cpu_after.tv_nsec - cpu_before.tv_nsec) / 1000));
+		reply.utime_us = usage.utime_us;
+		reply.stime_us = usage.stime_us;
+		reply.maxrss_kb = usage.maxrss_kb;
+		reply.nvcsw = usage.nvcsw;
+		reply.nivcsw = usage.nivcsw;
+		if (write_full(fd, &reply, sizeof(reply)) != 0)
+			return 1;
+	}
+}
+
+/*
+ * Runs one time slice of a process image.
+ * Usage: execute <file> <offset> <result_fd> [<max_bytes> <quantum_ms>]
+ * Scans from <offset> to the next interrupt byte and writes its offset as a decimal line
+ * to <result_fd>, or 0 if the image ran to completion. Exits with 1 on error.
+ * With a non-zero <max_bytes> or <quantum_ms>, the slice stops once it has executed that many bytes
+ * or run for that long, and writes "preempt <offset>" with the offset to resume from instead.
+ * If the image has an up-to-date interrupt index, the offset is looked up without reading the image.
+ * Otherwise the image is read with pread() in large aligned chunks, with sequential read-ahead advised.
+ *
+ * Usage: execute --serve <fd>
+ * Runs as a long-lived pool worker, taking jobs from and replying on <fd> (see execproto.h).
+ */
+int main(int argc, char *argv[])
+{
+	if (argc == 3 && strcmp(argv[1], EXECUTOR_SERVE_FLAG) == 0)
+		return serve(atoi(argv[2]));
+
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s <file> <offset> <result_fd> [<max_bytes> <quantum_ms>]\n", argv[0]);
+		fprintf(stderr, "       %s %s <fd>\n", argv[0], EXECUTOR_SERVE_FLAG);
+		return 1;
+	}
+
+	char *endptr;
+	errno = 0;
+	const off_t offset = (off_t)strtoll(argv[2], &endptr, 10);
+	if (*endptr != '\0' || errno != 0 || offset < 0) {
+		fprintf(stderr, "Invalid offset '%s'.\n", argv[2]);
+		return 1;
+	}
+	const int result_fd = atoi(argv[3]);
+	const unsigned long long max_bytes = argc > 4 ? strtoull(argv[4], NULL, 10) : 0;
+	const unsigned int quantum_ms = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 10) : 0;
+
+	const int fd = open(argv[1], O_RDONLY);
+	if (fd == -1) {
+		perror("Error opening process file.");
+		return 1;
+	}
+
+	struct stat st;
+	ImageStamp stamp;
+	ImageIndex index;
+	if (fstat(fd, &st) == -1) {
+		perror("Error reading process file.");
+		close(fd);
+		return 1;
+	}
+	imgindex_stamp(&st, &stamp);
+	const bool indexed = imgindex_open(argv[1], &stamp, &index) == 0;
+	off_t counter;
+	const int status = run_slice(fd, indexed ? &index : NULL, st.st_size, offset, max_bytes, quantum_ms, &counter);
+	if (indexed)
+		imgindex_close(&index);
+	close(fd);
+	if (status == -1) {
+		perror("Error reading process file.");
+		return 1;
+	}
+
+	if (dprintf(result_fd, "%s%lld\n", status == PREEMPTED ? "preempt " : "", (long long)counter) < 0) {
+		perror("Error writing result.");
+		return 1;
+	}
+	return 0;
+}
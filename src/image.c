@@ -0,0 +1,526 @@
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scan.h"
+#include "color_library.h"
+
+/*
+ * Process image registry.
+ * Each distinct file (same device and inode) is opened, stat'ed and mapped once. Every canonical path
+ * that has been registered for it is remembered in an alias table, so loading the same image again costs
+ * a realpath() and a hash lookup. PCBs refer to images by a small ImageId.
+ * Images larger than IMAGE_MAP_LIMIT are not mapped; they keep their descriptor open and are read
+ * with pread() in aligned IMAGE_CHUNK_BYTES chunks, cached per thread.
+ */
+
+/* The chunk of a streamed image most recently read by a thread. */
+typedef struct {
+    unsigned char *data;
+    dev_t dev;
+    ImageStamp stamp;
+    off_t base;  // image offset of data[0], a multiple of IMAGE_CHUNK_BYTES
+    size_t len;  // valid bytes in data, 0 if nothing is cached
+} ChunkCache;
+
+typedef struct {
+    char *key;  // path as passed to image_register(); NULL marks an empty slot
+    ImageId id;
+} AliasSlot;
+
+static ProcessImage *g_images = NULL; // g_images[id - 1]
+static ImageId g_image_count = 0;
+static ImageId g_image_capacity = 0;
+
+static AliasSlot *g_aliases = NULL;
+static size_t g_alias_capacity = 0; // always a power of two
+static size_t g_alias_count = 0;
+
+static pthread_key_t g_chunk_key; // ChunkCache of the calling thread
+static pthread_once_t g_chunk_once = PTHREAD_ONCE_INIT;
+static bool g_chunk_key_created = false;
+
+/**
+ * @brief FNV-1a hash of a path string.
+ */
+static uint64_t hash_path(const char *path) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+        h ^= *c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Looks a canonical path up in the alias table.
+ * @return The image id, or NO_IMAGE if the path has not been registered.
+ */
+static ImageId alias_find(const char *path) {
+    if (!g_aliases) return NO_IMAGE;
+    for (size_t i = hash_path(path) & (g_alias_capacity - 1);; i = (i + 1) & (g_alias_capacity - 1)) {
+        if (!g_aliases[i].key) return NO_IMAGE;
+        if (strcmp(g_aliases[i].key, path) == 0) return g_aliases[i].id;
+    }
+}
+
+/**
+ * @brief Adds a canonical path for an image, growing the table at a load factor of 1/2.
+ * @return 0 on success, -1 if allocation fails.
+ */
+static int alias_add(const char *path, const ImageId id) {
+    if ((g_alias_count + 1) * 2 > g_alias_capacity) {
+        const size_t capacity = g_alias_capacity ? g_alias_capacity * 2 : 64;
+        AliasSlot *table = calloc(capacity, sizeof(AliasSlot));
+        if (!table) return -1;
+        for (size_t i = 0; i < g_alias_capacity; i++) {
+            if (!g_aliases[i].key) continue;
+            size_t j = hash_path(g_aliases[i].key) & (capacity - 1);
+            while (table[j].key) j = (j + 1) & (capacity - 1);
+            table[j] = g_aliases[i];
+        }
+        free(g_aliases);
+        g_aliases = table;
+        g_alias_capacity = capacity;
+    }
+
+    char *key = strdup(path);
+    if (!key) return -1;
+    size_t i = hash_path(path) & (g_alias_capacity - 1);
+    while (g_aliases[i].key) i = (i + 1) & (g_alias_capacity - 1);
+    g_aliases[i].key = key;
+    g_aliases[i].id = id;
+    g_alias_count++;
+    return 0;
+}
+
+/**
+ * @brief Makes the contents of an open image file available.
+ * @details Images up to IMAGE_MAP_LIMIT are mapped and their descriptor is closed; the mapping is
+ * advised for sequential access. Larger images keep the descriptor, advised the same way, for pread().
+ * @param fd Descriptor of the file. It is consumed in every case.
+ * @param size Size of the file in bytes.
+ * @param data Receives the mapping, or NULL for an empty or streamed file.
+ * @param stream_fd Receives the descriptor of a streamed file, or -1.
+ * @return 0 on success, -1 on failure.
+ */
+static int load_contents(const int fd, const off_t size, const unsigned char **data, int *stream_fd) {
+    *data = NULL;
+    *stream_fd = -1;
+    if (size > IMAGE_MAP_LIMIT) {
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        *stream_fd = fd;
+        return 0;
+    }
+    if (size > 0) {
+        void *addr = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        if (size > IMAGE_CHUNK_BYTES) posix_madvise(addr, (size_t)size, POSIX_MADV_SEQUENTIAL);
+        *data = addr;
+    }
+    close(fd); // the mapping stays valid after the descriptor is closed
+    return 0;
+}
+
+/**
+ * @brief Unmaps or closes the contents of an image.
+ */
+static void release_contents(ProcessImage *img) {
+    if (img->data) munmap((void *)img->data, (size_t)img->size);
+    if (img->stream_fd != -1) close(img->stream_fd);
+    img->data = NULL;
+    img->stream_fd = -1;
+}
+
+/**
+ * @brief Reloads an image if the file at its path changed since it was loaded.
+ * @details The file changed if it is another file (it was replaced, e.g. by a rename) or if its size or
+ * modification time differ. The old contents are dropped even if the new ones cannot be loaded, since a
+ * mapping of a file truncated in the meantime faults on access; the image is then marked stale. Also
+ * picks up an interrupt index compiled since the image was last loaded.
+ * @param img The image to check.
+ * @return 1 if the image was reloaded, 0 if it is unchanged, -1 if it changed or is gone and could not be reloaded.
+ */
+static int refresh_image(ProcessImage *img) {
+    struct stat st;
+    ImageStamp stamp;
+    const int fd = open(img->path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        if (fd != -1) close(fd);
+        release_contents(img);
+        imgindex_close(&img->index);
+        img->stale = true;
+        return -1;
+    }
+
+    imgindex_stamp(&st, &stamp);
+    if (!img->stale && st.st_dev == img->dev && imgindex_stamp_equal(&stamp, &img->stamp)) {
+        close(fd);
+        if (!img->index.map) imgindex_open(img->path, &img->stamp, &img->index);
+        return 0;
+    }
+
+    release_contents(img);
+    imgindex_close(&img->index);
+    img->dev = st.st_dev;
+    img->ino = st.st_ino;
+    img->size = st.st_size;
+    img->stamp = stamp;
+    img->stale = load_contents(fd, st.st_size, &img->data, &img->stream_fd) != 0;
+    if (img->stale) return -1;
+    imgindex_open(img->path, &img->stamp, &img->index);
+    return 1;
+}
+
+/**
+ * @brief Registers a process image, or takes another reference to an already registered one.
+ * @details The path is first resolved with realpath(), so a relative path names the file in the current
+ * directory, not the one it resolved to when it was first loaded. A known canonical path is then a hash
+ * lookup. A new one is opened and matched against registered images by device and inode (e.g. a hard
+ * link) before a new image is created.
+ * @param path Path of the process image.
+ * @return The image id, or NO_IMAGE if the file could not be resolved, opened or mapped.
+ */
+ImageId image_register(const char *path) {
+    char canonical[PATH_MAX];
+    if (!realpath(path, canonical)) {
+        printf("%sError: Could not open process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+        return NO_IMAGE;
+    }
+
+    ImageId id = alias_find(canonical);
+    if (id != NO_IMAGE) {
+        ProcessImage *img = &g_images[id - 1];
+        if (img->refs == 0 && refresh_image(img) == -1) {
+            printf("%sError: Could not reload process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+            return NO_IMAGE;
+        }
+        img->refs++;
+        return id;
+    }
+
+    const int fd = open(canonical, O_RDONLY);
+    if (fd == -1) {
+        printf("%sError: Could not open process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+        return NO_IMAGE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        printf("%sError: Could not stat process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+        close(fd);
+        return NO_IMAGE;
+    }
+
+    /* same file under a different spelling */
+    for (ImageId i = 0; i < g_image_count; i++) {
+        if (g_images[i].dev == st.st_dev && g_images[i].ino == st.st_ino) {
+            close(fd);
+            if (alias_add(canonical, i + 1) != 0) return NO_IMAGE;
+            if (g_images[i].refs == 0 && refresh_image(&g_images[i]) == -1) {
+                printf("%sError: Could not reload process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+                return NO_IMAGE;
+            }
+            g_images[i].refs++;
+            return i + 1;
+        }
+    }
+
+    if (g_image_count == g_image_capacity) {
+        const ImageId capacity = g_image_capacity ? g_image_capacity * 2 : 16;
+        ProcessImage *images = realloc(g_images, capacity * sizeof(ProcessImage));
+        if (!images) {
+            close(fd);
+            return NO_IMAGE;
+        }
+        g_images = images;
+        g_image_capacity = capacity;
+    }
+
+    ProcessImage img = {0};
+    img.path = strdup(canonical);
+    img.size = st.st_size;
+    img.dev = st.st_dev;
+    img.ino = st.st_ino;
+    imgindex_stamp(&st, &img.stamp);
+
+    if (!img.path || load_contents(fd, st.st_size, &img.data, &img.stream_fd) != 0) {
+        printf("%sError: Could not map process image '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+        if (!img.path) close(fd);
+        free(img.path);
+        return NO_IMAGE;
+    }
+
+    imgindex_open(img.path, &img.stamp, &img.index);
+
+    id = g_image_count + 1;
+    if (alias_add(canonical, id) != 0) {
+        imgindex_close(&img.index);
+        release_contents(&img);
+        free(img.path);
+        return NO_IMAGE;
+    }
+    img.refs = 1;
+    g_images[g_image_count++] = img;
+    return id;
+}
+
+/**
+ * @brief Drops a PCB's reference to an image.
+ * @details The image stays registered and mapped so that loading it again is free.
+ * @param id The image id (NO_IMAGE is ignored).
+ */
+void image_release(const ImageId id) {
+    if (id == NO_IMAGE || id > g_image_count) return;
+    if (g_images[id - 1].refs > 0) g_images[id - 1].refs--;
+}
+
+/**
+ * @brief Gets a registered image.
+ * @param id The image id.
+ * @return A constant pointer to the image, or NULL for NO_IMAGE or an unknown id.
+ */
+const ProcessImage *image_get(const ImageId id) {
+    if (id == NO_IMAGE || id > g_image_count) return NULL;
+    return &g_images[id - 1];
+}
+
+/**
+ * @brief Adds the usage of a slice to the totals of the image it ran from.
+ * @param id The image id. Nothing happens for NO_IMAGE or an unknown id.
+ * @param usage Usage of the slice.
+ */
+void image_charge(const ImageId id, const ResourceUsage *usage) {
+    if (id == NO_IMAGE || id > g_image_count) return;
+    resusage_add(&g_images[id - 1].usage, usage);
+}
+
+/**
+ * @brief Returns the number of registered images. Valid ids are 1 to image_count().
+ */
+ImageId image_count(void) {
+    return g_image_count;
+}
+
+/**
+ * @brief Reloads every image referenced by a PCB whose file changed since it was loaded.
+ * @details Called when a dispatch starts, so that no slice runs from a mapping of a file that was
+ * truncated or replaced in the meantime. PCBs keep their offsets into the new contents; slices of
+ * a stale image fail.
+ */
+void image_revalidate(void) {
+    for (ImageId i = 0; i < g_image_count; i++) {
+        ProcessImage *img = &g_images[i];
+        if (img->refs == 0) continue;
+        const int result = refresh_image(img);
+        if (result == 1) {
+            printf("%sProcess image '%s' changed on disk and was reloaded.%s\n", YELLOW, img->path, RESET);
+        } else if (result == -1) {
+            printf("%sError: Process image '%s' changed on disk and could not be reloaded --> %s%s\n", RED, img->path,
+                   strerror(errno), RESET);
+        }
+    }
+}
+
+/**
+ * @brief Reloads the interrupt index of a registered image after it has been recompiled.
+ * @details Images that are not registered are ignored; they pick up the index when loaded.
+ * @param path Path of the process image, in any spelling.
+ */
+void image_reindex(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == -1) return;
+    for (ImageId i = 0; i < g_image_count; i++) {
+        ProcessImage *img = &g_images[i];
+        if (img->dev != st.st_dev || img->ino != st.st_ino) continue;
+        imgindex_close(&img->index);
+        imgindex_open(img->path, &img->stamp, &img->index);
+        return;
+    }
+}
+
+/**
+ * @brief Frees a thread's chunk cache when the thread exits.
+ */
+static void free_chunk_cache(void *arg) {
+    ChunkCache *cache = arg;
+    free(cache->data);
+    free(cache);
+}
+
+static void create_chunk_key(void) {
+    g_chunk_key_created = pthread_key_create(&g_chunk_key, free_chunk_cache) == 0;
+}
+
+/**
+ * @brief Gets the calling thread's chunk cache, allocating it on first use.
+ * @return The cache, or NULL if it could not be allocated.
+ */
+static ChunkCache *thread_chunk_cache(void) {
+    pthread_once(&g_chunk_once, create_chunk_key);
+    if (!g_chunk_key_created) return NULL;
+    ChunkCache *cache = pthread_getspecific(g_chunk_key);
+    if (cache) return cache;
+
+    cache = calloc(1, sizeof(ChunkCache));
+    if (!cache) return NULL;
+    cache->data = malloc(IMAGE_CHUNK_BYTES);
+    if (!cache->data || pthread_setspecific(g_chunk_key, cache) != 0) {
+        free(cache->data);
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+/**
+ * @brief Gets the bytes of an image starting at an offset.
+ * @details Mapped images return a pointer into the mapping. Streamed images are read with pread()
+ * in the IMAGE_CHUNK_BYTES-aligned chunk containing the offset, which stays cached for the calling
+ * thread, so consecutive slices of the same region cost no system call. The returned bytes are
+ * valid until the calling thread's next image_read().
+ * @param img The image.
+ * @param offset Offset of the first byte wanted.
+ * @param len In: the number of bytes wanted. Out: the number available, 0 at the end of the image.
+ * @return Pointer to the bytes, or NULL on a read error (errno is set).
+ */
+const unsigned char *image_read(const ProcessImage *img, const off_t offset, size_t *len) {
+    if (offset >= img->size) {
+        *len = 0;
+        return img->data;
+    }
+    if (img->stream_fd == -1) {
+        if (*len > (size_t)(img->size - offset)) *len = (size_t)(img->size - offset);
+        return img->data + offset;
+    }
+
+    ChunkCache *cache = thread_chunk_cache();
+    if (!cache) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    const off_t base = offset - offset % IMAGE_CHUNK_BYTES;
+    if (cache->len == 0 || cache->base != base || cache->dev != img->dev ||
+        !imgindex_stamp_equal(&cache->stamp, &img->stamp)) {
+        cache->len = 0;
+        while (cache->len < IMAGE_CHUNK_BYTES) {
+            const ssize_t n = pread(img->stream_fd, cache->data + cache->len, IMAGE_CHUNK_BYTES - cache->len,
+                                    base + (off_t)cache->len);
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) {
+                cache->len = 0;
+                return NULL;
+            }
+            if (n == 0) break;
+            cache->len += (size_t)n;
+        }
+        cache->base = base;
+        cache->dev = img->dev;
+        cache->stamp = img->stamp;
+    }
+
+    const size_t skip = (size_t)(offset - base);
+    const size_t available = cache->len > skip ? cache->len - skip : 0;
+    if (*len > available) *len = available;
+    return cache->data + skip;
+}
+
+/**
+ * @brief Finds the next interrupt at or after an offset, before an end offset.
+ * @details Uses the interrupt index when one is loaded, and otherwise scans the image chunk by chunk.
+ * @param img The image.
+ * @param start Offset to search from.
+ * @param end Offset to stop searching at; anything past the image size means the whole rest of the image.
+ * @param next_offset Receives the offset of the interrupt byte, or 0 if there is none before end.
+ * @return 0 on success, -1 on a read error.
+ */
+int image_next_interrupt(const ProcessImage *img, const off_t start, off_t end, off_t *next_offset) {
+    if (end > img->size) end = img->size;
+    if (img->index.map) {
+        *next_offset = imgindex_next(&img->index, start);
+        if (*next_offset >= end) *next_offset = 0;
+        return 0;
+    }
+
+    *next_offset = 0;
+    for (off_t pos = start; pos < end;) {
+        size_t len = (size_t)(end - pos);
+        const unsigned char *bytes = image_read(img, pos, &len);
+        if (!bytes) return -1;
+        if (len == 0) break;
+        const unsigned char *hit = scan_interrupt(bytes, len);
+        if (hit) {
+            *next_offset = pos + (hit - bytes);
+            break;
+        }
+        pos += (off_t)len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Asks the kernel to start reading the region a PCB will execute next.
+ * @details The region runs to the next interrupt when the image is indexed, and is otherwise one
+ * chunk; it is capped at IMAGE_PREFETCH_MAX. Small images are skipped since they stay resident.
+ * @param img The image.
+ * @param offset Offset the next slice starts at.
+ */
+void image_prefetch(const ProcessImage *img, const off_t offset) {
+    if (img->size <= IMAGE_CHUNK_BYTES || offset >= img->size) return;
+
+    off_t end = offset + IMAGE_CHUNK_BYTES;
+    if (img->index.map) {
+        const off_t next = imgindex_next(&img->index, offset);
+        end = next ? next + 1 : img->size;
+    }
+    if (end > offset + IMAGE_PREFETCH_MAX) end = offset + IMAGE_PREFETCH_MAX;
+    if (end > img->size) end = img->size;
+
+    if (img->data) {
+        static long page_size = 0;
+        if (!page_size) page_size = sysconf(_SC_PAGESIZE);
+        const off_t base = offset - offset % page_size;
+        posix_madvise((void *)(img->data + base), (size_t)(end - base), POSIX_MADV_WILLNEED);
+    } else {
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(img->stream_fd, offset, end - offset, POSIX_FADV_WILLNEED);
+#endif
+    }
+}
+
+/**
+ * @brief Unmaps and forgets every registered image.
+ */
+void image_cleanup(void) {
+    for (ImageId i = 0; i < g_image_count; i++) {
+        imgindex_close(&g_images[i].index);
+        release_contents(&g_images[i]);
+        free(g_images[i].path);
+    }
+    if (g_chunk_key_created) { // other threads free their cache on exit
+        ChunkCache *cache = pthread_getspecific(g_chunk_key);
+        if (cache) free_chunk_cache(cache);
+        pthread_setspecific(g_chunk_key, NULL);
+    }
+    for (size_t i = 0; i < g_alias_capacity; i++) free(g_aliases[i].key);
+    free(g_images);
+    free(g_aliases);
+    g_images = NULL;
+    g_aliases = NULL;
+    g_image_count = g_image_capacity = 0;
+    g_alias_count = g_alias_capacity = 0;
+}
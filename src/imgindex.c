@@ -0,0 +1,248 @@
+#include "imgindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scan.h"
+
+/*
+ * Interrupt index of a process image.
+ * Resuming a process normally rescans its image from the last interrupt to the next one. The
+ * index lists every interrupt offset up front, so the next slice boundary is a binary search.
+ * It is stored next to the image as "<image>.idx" and shared by TechOS and the execute binary.
+ */
+
+/* Bytes of the image read and scanned per step while compiling. */
+#define IMGINDEX_CHUNK_BYTES (1 << 20)
+
+/* Nanosecond file times are st_mtim/st_ctim in POSIX.1-2008 and st_mtimespec/st_ctimespec on macOS. */
+#ifdef __APPLE__
+#define ST_MTIM st_mtimespec
+#define ST_CTIM st_ctimespec
+#else
+#define ST_MTIM st_mtim
+#define ST_CTIM st_ctim
+#endif
+
+/**
+ * @brief Records the version of an image file.
+ * @param st Status of the image file.
+ * @param stamp Receives the stamp.
+ */
+void imgindex_stamp(const struct stat *st, ImageStamp *stamp) {
+    stamp->size = (uint64_t)st->st_size;
+    stamp->ino = (uint64_t)st->st_ino;
+    stamp->mtime_sec = (int64_t)st->ST_MTIM.tv_sec;
+    stamp->mtime_nsec = (int64_t)st->ST_MTIM.tv_nsec;
+    stamp->ctime_sec = (int64_t)st->ST_CTIM.tv_sec;
+    stamp->ctime_nsec = (int64_t)st->ST_CTIM.tv_nsec;
+}
+
+/**
+ * @brief Returns whether two stamps describe the same version of a file.
+ */
+bool imgindex_stamp_equal(const ImageStamp *a, const ImageStamp *b) {
+    return a->size == b->size && a->ino == b->ino && a->mtime_sec == b->mtime_sec &&
+           a->mtime_nsec == b->mtime_nsec && a->ctime_sec == b->ctime_sec && a->ctime_nsec == b->ctime_nsec;
+}
+
+/**
+ * @brief Builds the path of the index that belongs to an image.
+ * @return 0 on success, -1 if the path does not fit.
+ */
+static int index_path(const char *image_path, char *buf, const size_t size) {
+    const int n = snprintf(buf, size, "%s%s", image_path, IMGINDEX_SUFFIX);
+    if (n < 0 || (size_t)n >= size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a buffer completely, retrying short writes.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_all(const int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        const ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads an image in chunks and collects the offset of every interrupt byte.
+ * @param fd Descriptor of the image.
+ * @param offsets Receives a malloc'd array of offsets in ascending order (NULL if there are none).
+ * @param count Receives the number of offsets.
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+static int collect_offsets(const int fd, uint64_t **offsets, uint64_t *count) {
+    *offsets = NULL;
+    *count = 0;
+    unsigned char *chunk = malloc(IMGINDEX_CHUNK_BYTES);
+    if (!chunk) return -1;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    uint64_t capacity = 0;
+    for (off_t pos = 0;;) {
+        const ssize_t n = pread(fd, chunk, IMGINDEX_CHUNK_BYTES, pos);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == 0) break;
+        if (n == -1) {
+            free(chunk);
+            free(*offsets);
+            return -1;
+        }
+        const unsigned char *end = chunk + n;
+        for (const unsigned char *hit = chunk; hit < end; hit++) {
+            hit = scan_interrupt(hit, (size_t)(end - hit));
+            if (!hit) break;
+            if (*count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                uint64_t *grown = realloc(*offsets, capacity * sizeof(uint64_t));
+                if (!grown) {
+                    free(chunk);
+                    free(*offsets);
+                    return -1;
+                }
+                *offsets = grown;
+            }
+            (*offsets)[(*count)++] = (uint64_t)(pos + (hit - chunk));
+        }
+        pos += n;
+    }
+    free(chunk);
+    return 0;
+}
+
+/**
+ * @brief Scans an image and writes its interrupt index.
+ * @details The index is written to a temporary file and renamed into place, so a concurrent
+ * reader sees either the old index or the complete new one.
+ * @param image_path Path of the process image.
+ * @return The number of interrupts indexed, or -1 on failure (errno is set).
+ */
+long long imgindex_compile(const char *image_path) {
+    char path[PATH_MAX], tmp_path[PATH_MAX];
+    if (index_path(image_path, path, sizeof(path)) != 0) return -1;
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    const int fd = open(image_path, O_RDONLY);
+    if (fd == -1) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    uint64_t *offsets;
+    uint64_t count;
+    const int collected = collect_offsets(fd, &offsets, &count);
+    close(fd);
+    if (collected != 0) return -1;
+
+    ImageIndexHeader header = {0};
+    memcpy(header.magic, IMGINDEX_MAGIC, sizeof(header.magic));
+    header.version = IMGINDEX_VERSION;
+    imgindex_stamp(&st, &header.image);
+    header.count = count;
+
+    const int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out == -1) {
+        free(offsets);
+        return -1;
+    }
+    if (write_all(out, &header, sizeof(header)) != 0 ||
+        write_all(out, offsets, count * sizeof(uint64_t)) != 0 ||
+        close(out) != 0 || rename(tmp_path, path) != 0) {
+        const int err = errno;
+        unlink(tmp_path);
+        free(offsets);
+        errno = err;
+        return -1;
+    }
+    free(offsets);
+    return (long long)count;
+}
+
+/**
+ * @brief Loads the index of an image if it is present and still matches the image.
+ * @param image_path Path of the process image.
+ * @param image Stamp of the image version the index must have been compiled from.
+ * @param index Receives the index; it is cleared if no valid index exists.
+ * @return 0 if a valid index was loaded, -1 otherwise.
+ */
+int imgindex_open(const char *image_path, const ImageStamp *image, ImageIndex *index) {
+    memset(index, 0, sizeof(*index));
+
+    char path[PATH_MAX];
+    if (index_path(image_path, path, sizeof(path)) != 0) return -1;
+    const int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ImageIndexHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const ImageIndexHeader *header = map;
+    if (memcmp(header->magic, IMGINDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != IMGINDEX_VERSION ||
+        !imgindex_stamp_equal(&header->image, image) ||
+        header->count != ((uint64_t)st.st_size - sizeof(ImageIndexHeader)) / sizeof(uint64_t)) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    index->offsets = (const uint64_t *)(header + 1);
+    index->count = header->count;
+    index->map = map;
+    index->map_size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * @brief Finds the first interrupt at or after an offset.
+ * @param index A valid index.
+ * @param start Offset to search from.
+ * @return The offset of the interrupt byte, or 0 if the image runs to completion.
+ */
+off_t imgindex_next(const ImageIndex *index, const off_t start) {
+    uint64_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (index->offsets[mid] < (uint64_t)start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < index->count ? (off_t)index->offsets[lo] : 0;
+}
+
+/**
+ * @brief Unmaps an index loaded by imgindex_open().
+ */
+void imgindex_close(ImageIndex *index) {
+    if (index->map) munmap(index->map, index->map_size);
+    memset(index, 0, sizeof(*index));
+}
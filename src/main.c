@@ -5,6 +5,14 @@
 #include "utils.h"
 #include "queue.h"
 #include "auth.h"
+#include "image.h"
+#include "output.h"
+#include "execpool.h"
+#include "waitchan.h"
+#include "scheduler.h"
+#include "edf.h"
+#include "owner.h"
+#include "pcb.h"
 
 /**
  * @brief Displays the welcome message for TechOS.
@@ -19,6 +27,7 @@ void welcome_message(void) {
 void init_techos(void) {
     init_techos_date();
     init_queues();
+    init_pcbs();
 
     /* Add other initializations here if needed in the future */
     printf("%sTechOS Initialized.%s\n", MAGENTA, RESET);
@@ -30,10 +39,14 @@ void init_techos(void) {
 void cleanup_techos(void) {
     // Add cleanup tasks here (e.g., freeing allocated memory) if needed
     printf("%sPerforming TechOS cleanup...%s\n", MAGENTA, RESET);
-    cleanup_queue(&g_ready_queue);
-    cleanup_queue(&g_blocked_queue);
-    cleanup_queue(&g_suspended_ready_queue);
-    cleanup_queue(&g_suspended_blocked_queue);
+    execpool_stop();
+    waitchan_cleanup();
+    scheduler_cleanup();
+    edf_cleanup();
+    owner_cleanup();
+    cleanup_pcbs();
+    image_cleanup();
+    output_cleanup();
     printf("%sTechOS cleanup completed.%s\n", MAGENTA, RESET);
 }
 
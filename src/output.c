@@ -0,0 +1,302 @@
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "scan.h"
+#include "color_library.h"
+
+/*
+ * Process output sinks.
+ * When a slice finishes, the bytes it executed are decoded with the vectorized decoder and handed
+ * to the sink of its PCB. Stdout and file sinks stage decoded bytes and write them with a single
+ * writev() once a batch fills up or the dispatcher flushes; ring sinks keep the most recent bytes
+ * in memory. Sinks are only touched from the dispatching thread.
+ */
+
+static OutputSink g_sinks[MAX_OUTPUT_SINKS + 1]; // g_sinks[id], index 0 unused
+
+/**
+ * @brief Finds a free slot for a new sink.
+ * @details When the table is full, the storage of an unreferenced ring sink is reclaimed.
+ * @return The slot id, or NO_SINK if every sink is in use.
+ */
+static SinkId find_free_slot(void) {
+    for (int id = STDOUT_SINK + 1; id <= MAX_OUTPUT_SINKS; id++) {
+        if (g_sinks[id].kind == SINK_NONE) return (SinkId)id;
+    }
+    for (int id = STDOUT_SINK + 1; id <= MAX_OUTPUT_SINKS; id++) {
+        if (g_sinks[id].kind == SINK_RING && g_sinks[id].refs == 0) {
+            free(g_sinks[id].data);
+            memset(&g_sinks[id], 0, sizeof(OutputSink));
+            return (SinkId)id;
+        }
+    }
+    return NO_SINK;
+}
+
+/**
+ * @brief Writes a sink's staged batch with writev(), retrying partial writes.
+ */
+static void flush_sink(OutputSink *sink) {
+    if (sink->iov_count == 0) return;
+    if (sink->kind == SINK_STDOUT) fflush(stdout); // keep ordering with buffered messages
+
+    struct iovec *iov = sink->iov;
+    int count = sink->iov_count;
+    while (count > 0) {
+        ssize_t n = writev(sink->fd, iov, count);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            printf("%sOutput: Could not write to %s --> %s%s\n", RED,
+                   sink->path ? sink->path : "stdout", strerror(errno), RESET);
+            break;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    sink->iov_count = 0;
+    sink->used = 0;
+}
+
+/**
+ * @brief Appends a segment to a sink's batch, merging it with the previous one when contiguous.
+ */
+static void push_iov(OutputSink *sink, void *base, const size_t len) {
+    if (sink->iov_count > 0) {
+        struct iovec *last = &sink->iov[sink->iov_count - 1];
+        if ((char *)last->iov_base + last->iov_len == (char *)base) {
+            last->iov_len += len;
+            return;
+        }
+    }
+    sink->iov[sink->iov_count].iov_base = base;
+    sink->iov[sink->iov_count].iov_len = len;
+    sink->iov_count++;
+}
+
+/**
+ * @brief Allocates the batch buffer of a stdout or file sink.
+ * @return 0 on success, -1 if allocation fails.
+ */
+static int alloc_batch(OutputSink *sink) {
+    sink->data = malloc(OUTPUT_BATCH_BYTES);
+    if (!sink->data) return -1;
+    sink->capacity = OUTPUT_BATCH_BYTES;
+    return 0;
+}
+
+/**
+ * @brief Takes a reference to the shared stdout sink.
+ * @return STDOUT_SINK, or NO_SINK if its batch buffer could not be allocated.
+ */
+SinkId output_open_stdout(void) {
+    OutputSink *sink = &g_sinks[STDOUT_SINK];
+    if (sink->kind == SINK_NONE) {
+        if (alloc_batch(sink) != 0) return NO_SINK;
+        sink->kind = SINK_STDOUT;
+        sink->fd = STDOUT_FILENO;
+    }
+    sink->refs++;
+    return STDOUT_SINK;
+}
+
+/**
+ * @brief Takes a reference to a file sink, opening and truncating the file if no sink writes to it yet.
+ * @param path Path of the output file.
+ * @return The sink id, or NO_SINK on failure.
+ */
+SinkId output_open_file(const char *path) {
+    for (int id = STDOUT_SINK + 1; id <= MAX_OUTPUT_SINKS; id++) {
+        if (g_sinks[id].kind == SINK_FILE && strcmp(g_sinks[id].path, path) == 0) {
+            g_sinks[id].refs++;
+            return (SinkId)id;
+        }
+    }
+
+    const SinkId id = find_free_slot();
+    if (id == NO_SINK) {
+        printf("%sError: All %d output sinks are in use.%s\n", RED, MAX_OUTPUT_SINKS, RESET);
+        return NO_SINK;
+    }
+    OutputSink *sink = &g_sinks[id];
+    sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (sink->fd == -1) {
+        printf("%sError: Could not open output file '%s' --> %s%s\n", RED, path, strerror(errno), RESET);
+        return NO_SINK;
+    }
+    sink->path = strdup(path);
+    if (!sink->path || alloc_batch(sink) != 0) {
+        close(sink->fd);
+        free(sink->path);
+        memset(sink, 0, sizeof(OutputSink));
+        return NO_SINK;
+    }
+    sink->kind = SINK_FILE;
+    sink->refs = 1;
+    return id;
+}
+
+/**
+ * @brief Creates a ring buffer sink that keeps the most recent decoded output.
+ * @param capacity Size of the ring in bytes.
+ * @return The sink id, or NO_SINK on failure.
+ */
+SinkId output_open_ring(const size_t capacity) {
+    const SinkId id = find_free_slot();
+    if (id == NO_SINK) {
+        printf("%sError: All %d output sinks are in use.%s\n", RED, MAX_OUTPUT_SINKS, RESET);
+        return NO_SINK;
+    }
+    OutputSink *sink = &g_sinks[id];
+    sink->data = malloc(capacity);
+    if (!sink->data) return NO_SINK;
+    sink->kind = SINK_RING;
+    sink->capacity = capacity;
+    sink->refs = 1;
+    return id;
+}
+
+/**
+ * @brief Drops a PCB's reference to a sink.
+ * @details A file sink is flushed and closed with its last reference. A ring sink is kept so its
+ * contents can still be shown after the PCB has finished; it is reclaimed only when the table fills up.
+ * @param id The sink id (NO_SINK is ignored).
+ */
+void output_release(const SinkId id) {
+    OutputSink *sink = &g_sinks[id];
+    if (id == NO_SINK || sink->refs == 0) return;
+    if (--sink->refs > 0) return;
+
+    if (sink->kind == SINK_FILE) {
+        flush_sink(sink);
+        close(sink->fd);
+        free(sink->path);
+        free(sink->data);
+        memset(sink, 0, sizeof(OutputSink));
+    } else if (sink->kind == SINK_STDOUT) {
+        flush_sink(sink);
+    }
+}
+
+/**
+ * @brief Gets a sink.
+ * @return A constant pointer to the sink, or NULL for NO_SINK or an unused id.
+ */
+const OutputSink *output_get(const SinkId id) {
+    if (id == NO_SINK || g_sinks[id].kind == SINK_NONE) return NULL;
+    return &g_sinks[id];
+}
+
+/**
+ * @brief Returns the display name of a sink kind.
+ */
+const char *output_kind_name(const SinkKind kind) {
+    switch (kind) {
+        case SINK_STDOUT: return "stdout";
+        case SINK_FILE: return "file";
+        case SINK_RING: return "ring";
+        default: return "none";
+    }
+}
+
+/**
+ * @brief Decodes the bytes a slice executed and emits them to a sink.
+ * @details On stdout, every slice is written as one line prefixed with the PCB name. Batches are
+ * written when the staging buffer or the iovec array fills up.
+ * @param id The sink id.
+ * @param label Name of the PCB that produced the output.
+ * @param data Encoded bytes of the slice.
+ * @param len Number of bytes.
+ */
+void output_slice(const SinkId id, const char *label, const unsigned char *data, size_t len) {
+    OutputSink *sink = &g_sinks[id];
+    if (id == NO_SINK || sink->kind == SINK_NONE || len == 0) return;
+    sink->written += len;
+
+    if (sink->kind == SINK_RING) {
+        if (len > sink->capacity) { // only the newest bytes survive
+            data += len - sink->capacity;
+            len = sink->capacity;
+        }
+        while (len > 0) {
+            const size_t n = len < sink->capacity - sink->head ? len : sink->capacity - sink->head;
+            scan_decode(sink->data + sink->head, data, n);
+            sink->head = (sink->head + n) % sink->capacity;
+            sink->used = sink->used + n < sink->capacity ? sink->used + n : sink->capacity;
+            data += n;
+            len -= n;
+        }
+        return;
+    }
+
+    bool first = true;
+    while (len > 0) {
+        if (sink->iov_count + 3 > OUTPUT_BATCH_IOVECS || sink->used == sink->capacity) flush_sink(sink);
+        if (first && sink->kind == SINK_STDOUT) {
+            char *prefix = sink->labels[sink->iov_count];
+            const int n = snprintf(prefix, sizeof(sink->labels[0]), "[%s] ", label);
+            push_iov(sink, prefix, (size_t)n);
+        }
+        const size_t n = len < sink->capacity - sink->used ? len : sink->capacity - sink->used;
+        scan_decode(sink->data + sink->used, data, n);
+        push_iov(sink, sink->data + sink->used, n);
+        sink->used += n;
+        data += n;
+        len -= n;
+        first = false;
+    }
+    if (sink->kind == SINK_STDOUT && sink->data[sink->used - 1] != '\n') {
+        push_iov(sink, "\n", 1);
+    }
+}
+
+/**
+ * @brief Gets the contents of a ring sink, oldest byte first.
+ * @param id The sink id.
+ * @param parts Receive the start of the two contiguous parts of the ring.
+ * @param lens Receive the lengths of the two parts.
+ * @return The total number of bytes held, or 0 if the sink is not a ring.
+ */
+size_t output_ring_read(const SinkId id, const unsigned char *parts[2], size_t lens[2]) {
+    const OutputSink *sink = output_get(id);
+    if (!sink || sink->kind != SINK_RING) return 0;
+    const size_t start = sink->used < sink->capacity ? 0 : sink->head;
+    parts[0] = sink->data + start;
+    lens[0] = sink->used - (sink->used < sink->capacity ? 0 : start);
+    parts[1] = sink->data;
+    lens[1] = sink->used - lens[0];
+    return sink->used;
+}
+
+/**
+ * @brief Writes the staged batches of every stdout and file sink.
+ */
+void output_flush(void) {
+    for (int id = STDOUT_SINK; id <= MAX_OUTPUT_SINKS; id++) {
+        if (g_sinks[id].kind == SINK_STDOUT || g_sinks[id].kind == SINK_FILE) flush_sink(&g_sinks[id]);
+    }
+}
+
+/**
+ * @brief Flushes, closes and frees every sink.
+ */
+void output_cleanup(void) {
+    output_flush();
+    for (int id = STDOUT_SINK; id <= MAX_OUTPUT_SINKS; id++) {
+        if (g_sinks[id].kind == SINK_FILE) close(g_sinks[id].fd);
+        free(g_sinks[id].path);
+        free(g_sinks[id].data);
+    }
+    memset(g_sinks, 0, sizeof(g_sinks));
+}
@@ -0,0 +1,98 @@
+#include "owner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Capacity of the registry's first allocation. */
+#define OWNER_MIN_CAPACITY 8
+
+/* Registered owners; OwnerId n is g_owners[n - 1]. */
+static Owner *g_owners = NULL;
+static OwnerId g_owner_count = 0;
+static OwnerId g_owner_capacity = 0;
+
+/**
+ * @brief Returns the owner id of the logged-in user, registering the user on first use.
+ * @details The owner's role is refreshed, so a user promoted or demoted since their last PCB gets
+ * the weight of their current role.
+ * @return The owner id, or NO_OWNER if the registry could not grow.
+ */
+OwnerId owner_current(void) {
+    const User *user = get_current_user();
+    for (OwnerId id = 1; id <= g_owner_count; id++) {
+        Owner *owner = &g_owners[id - 1];
+        if (strcmp(owner->name, user->username) == 0) {
+            owner->role = user->role;
+            return id;
+        }
+    }
+
+    if (g_owner_count == g_owner_capacity) {
+        if (g_owner_capacity == UINT16_MAX) return NO_OWNER;
+        const uint32_t wanted = g_owner_capacity ? 2u * g_owner_capacity : OWNER_MIN_CAPACITY;
+        const OwnerId capacity = wanted > UINT16_MAX ? UINT16_MAX : (OwnerId)wanted;
+        Owner *owners = realloc(g_owners, capacity * sizeof(Owner));
+        if (!owners) return NO_OWNER;
+        g_owners = owners;
+        g_owner_capacity = capacity;
+    }
+
+    Owner *owner = &g_owners[g_owner_count];
+    memset(owner, 0, sizeof(Owner));
+    snprintf(owner->name, sizeof(owner->name), "%s", user->username);
+    owner->role = user->role;
+    return ++g_owner_count;
+}
+
+/**
+ * @brief Returns an owner by id.
+ * @return Pointer to the owner, or NULL for NO_OWNER or an unknown id.
+ */
+Owner *owner_get(const OwnerId id) {
+    return id != NO_OWNER && id <= g_owner_count ? &g_owners[id - 1] : NULL;
+}
+
+/**
+ * @brief Returns the number of registered owners. Their ids are 1 to the returned count.
+ */
+OwnerId owner_count(void) {
+    return g_owner_count;
+}
+
+/**
+ * @brief Returns the fair-share weight of an owner: 1 for basic users, 2 for admins and 4 for root.
+ */
+unsigned int owner_weight(const Owner *owner) {
+    switch (owner->role) {
+        case ROLE_ROOT: return 4;
+        case ROLE_ADMIN: return 2;
+        default: return 1;
+    }
+}
+
+/**
+ * @brief Returns the name of a role as written in the accounts file.
+ */
+const char *owner_role_name(const UserRole role) {
+    switch (role) {
+        case ROLE_ROOT: return "root";
+        case ROLE_ADMIN: return "admin";
+        case ROLE_BASIC: return "basic";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Empties every owner's ready heap and releases the registry.
+ * @details cleanup_techos() calls it after scheduler_cleanup() and edf_cleanup() and before cleanup_pcbs(),
+ * so no heap still points at a PCB when the PCBs are freed.
+ */
+void owner_cleanup(void) {
+    for (OwnerId id = 1; id <= g_owner_count; id++) {
+        pcbheap_clear(&g_owners[id - 1].ready);
+    }
+    free(g_owners);
+    g_owners = NULL;
+    g_owner_count = 0;
+    g_owner_capacity = 0;
+}
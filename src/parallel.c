@@ -0,0 +1,249 @@
+#include "parallel.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "engine.h"
+#include "color_library.h"
+
+/*
+ * Worker threads for the parallel dispatcher.
+ * Each worker owns a local ready deque kept in descending priority order. The dispatcher hands
+ * PCBs out round-robin; a worker whose deque is empty steals the highest-priority head from the
+ * other workers. Finished slices are posted to a completion ring that the dispatcher drains, so
+ * the global queues are only ever touched by the dispatching thread.
+ */
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    pthread_mutex_t lock;
+    PCB *head; // local ready deque, highest priority first
+    PCB *tail;
+} Worker;
+
+static Worker *g_workers = NULL;
+static int g_worker_count = 0;
+static int g_next_worker = 0;
+
+/* Number of PCBs sitting in local deques that no worker has claimed yet. */
+static pthread_mutex_t g_work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+static int g_pending = 0;
+static bool g_stopping = false;
+
+/* Completed slices waiting to be picked up by the dispatcher. */
+static pthread_mutex_t g_done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;
+static SliceResult *g_done_ring = NULL;
+static int g_done_capacity = 0;
+static int g_done_head = 0;
+static int g_done_count = 0;
+
+/**
+ * @brief Inserts a PCB into a worker's local deque in descending priority order.
+ * @param w The worker that owns the deque. Its lock must be held.
+ * @param p Pointer to the PCB to insert.
+ */
+static void local_push(Worker *w, PCB *p) {
+    PCB *cur = w->head;
+    while (cur && cur->priority >= p->priority) cur = cur->next;
+    p->next = cur;
+    p->prev = cur ? cur->prev : w->tail;
+    if (p->prev) p->prev->next = p; else w->head = p;
+    if (cur) cur->prev = p; else w->tail = p;
+}
+
+/**
+ * @brief Removes the highest-priority PCB from a worker's local deque.
+ * @param w The worker that owns the deque. Its lock must be held.
+ * @return Pointer to the PCB, or NULL if the deque is empty.
+ */
+static PCB *local_pop(Worker *w) {
+    PCB *p = w->head;
+    if (!p) return NULL;
+    w->head = p->next;
+    if (w->head) w->head->prev = NULL; else w->tail = NULL;
+    p->next = p->prev = NULL;
+    return p;
+}
+
+/**
+ * @brief Takes the next PCB for a worker, stealing from the other workers when its own deque is empty.
+ * @details The victim is the worker whose head has the highest priority, which keeps the global
+ * priority order approximately intact.
+ * @param self The worker looking for work.
+ * @return Pointer to the PCB, or NULL if every deque was empty at the time of the scan.
+ */
+static PCB *take_work(Worker *self) {
+    pthread_mutex_lock(&self->lock);
+    PCB *p = local_pop(self);
+    pthread_mutex_unlock(&self->lock);
+    if (p) return p;
+
+    Worker *victim = NULL;
+    int best_priority = -1;
+    for (int i = 1; i < g_worker_count; i++) {
+        Worker *w = &g_workers[(self->id + i) % g_worker_count];
+        pthread_mutex_lock(&w->lock);
+        if (w->head && w->head->priority > best_priority) {
+            best_priority = w->head->priority;
+            victim = w;
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+    if (!victim) return NULL;
+
+    pthread_mutex_lock(&victim->lock);
+    p = local_pop(victim);
+    pthread_mutex_unlock(&victim->lock);
+    return p;
+}
+
+/**
+ * @brief Posts a finished slice to the completion ring and wakes the dispatcher.
+ * @param result The slice outcome.
+ */
+static void post_result(const SliceResult *result) {
+    pthread_mutex_lock(&g_done_lock);
+    g_done_ring[(g_done_head + g_done_count) % g_done_capacity] = *result;
+    g_done_count++;
+    pthread_cond_signal(&g_done_cond);
+    pthread_mutex_unlock(&g_done_lock);
+}
+
+/**
+ * @brief Main loop of a worker thread.
+ * @details A worker first claims one pending PCB, then finds it in its own deque or by stealing.
+ * Because PCBs are pushed before they are counted as pending, a claimed PCB is always somewhere.
+ * @param arg Pointer to the Worker.
+ * @return Always NULL.
+ */
+static void *worker_main(void *arg) {
+    Worker *self = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&g_work_lock);
+        while (g_pending == 0 && !g_stopping) {
+            pthread_cond_wait(&g_work_cond, &g_work_lock);
+        }
+        if (g_pending == 0) {
+            pthread_mutex_unlock(&g_work_lock);
+            break;
+        }
+        g_pending--;
+        pthread_mutex_unlock(&g_work_lock);
+
+        PCB *p;
+        while (!(p = take_work(self))) {
+            sched_yield();
+        }
+
+        printf("%sDispatcher[%d]: Running '%s' (offset: %lld)...%s\n", YELLOW, self->id, p->p_name, (long long)p->offset, RESET);
+
+        SliceResult result = { p, 0, 0, self->id };
+        result.status = engine_run_slice(p, &result.next_offset);
+        post_result(&result);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Starts the worker threads.
+ * @details At most two slices per worker are in flight at once; the rest stay in the global ready queue
+ * so that its priority order still decides what runs next.
+ * @param workers Number of worker threads (1 to MAX_DISPATCH_WORKERS).
+ * @return 0 on success, -1 if the workers could not be started.
+ */
+int parallel_start(const int workers) {
+    g_workers = calloc((size_t)workers, sizeof(Worker));
+    g_done_capacity = workers * 2;
+    g_done_ring = calloc((size_t)g_done_capacity, sizeof(SliceResult));
+    if (!g_workers || !g_done_ring) {
+        free(g_workers);
+        free(g_done_ring);
+        g_workers = NULL;
+        g_done_ring = NULL;
+        return -1;
+    }
+
+    g_pending = 0;
+    g_stopping = false;
+    g_next_worker = 0;
+    g_done_head = g_done_count = 0;
+
+    for (g_worker_count = 0; g_worker_count < workers; g_worker_count++) {
+        Worker *w = &g_workers[g_worker_count];
+        w->id = g_worker_count;
+        pthread_mutex_init(&w->lock, NULL);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            pthread_mutex_destroy(&w->lock);
+            parallel_stop();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the maximum number of slices that may be in flight at once.
+ */
+int parallel_capacity(void) {
+    return g_done_capacity;
+}
+
+/**
+ * @brief Hands a PCB to the next worker's local deque.
+ * @param p Pointer to the PCB. It must not be in any global queue.
+ */
+void parallel_submit(PCB *p) {
+    Worker *w = &g_workers[g_next_worker];
+    g_next_worker = (g_next_worker + 1) % g_worker_count;
+
+    pthread_mutex_lock(&w->lock);
+    local_push(w, p);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_mutex_lock(&g_work_lock);
+    g_pending++;
+    pthread_cond_signal(&g_work_cond);
+    pthread_mutex_unlock(&g_work_lock);
+}
+
+/**
+ * @brief Blocks until a worker finishes a slice.
+ * @param result Receives the outcome of the slice.
+ */
+void parallel_wait(SliceResult *result) {
+    pthread_mutex_lock(&g_done_lock);
+    while (g_done_count == 0) {
+        pthread_cond_wait(&g_done_cond, &g_done_lock);
+    }
+    *result = g_done_ring[g_done_head];
+    g_done_head = (g_done_head + 1) % g_done_capacity;
+    g_done_count--;
+    pthread_mutex_unlock(&g_done_lock);
+}
+
+/**
+ * @brief Stops and joins the worker threads once all submitted slices have been taken.
+ */
+void parallel_stop(void) {
+    pthread_mutex_lock(&g_work_lock);
+    g_stopping = true;
+    pthread_cond_broadcast(&g_work_cond);
+    pthread_mutex_unlock(&g_work_lock);
+
+    for (int i = 0; i < g_worker_count; i++) {
+        pthread_join(g_workers[i].thread, NULL);
+        pthread_mutex_destroy(&g_workers[i].lock);
+    }
+
+    free(g_workers);
+    free(g_done_ring);
+    g_workers = NULL;
+    g_done_ring = NULL;
+    g_worker_count = 0;
+    g_done_capacity = 0;
+}
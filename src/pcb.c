@@ -1,32 +1,183 @@
 #include "pcb.h"
 #include "queue.h"
+#include "pool.h"
+#include "waitchan.h"
+#include "scheduler.h"
+#include "edf.h"
+#include "owner.h"
+#include "schedstats.h"
+#include "acct.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Number of PCBs carved from each slab of the PCB pool. */
+#define PCBS_PER_SLAB 256
+
+/* Every PCB comes from this pool, so creating and destroying PCBs never reaches malloc in steady state. */
+static Pool g_pcb_pool;
+/* The PCBExt records, one per PCB. */
+static Pool g_ext_pool;
+
+/*
+ * Name index: an open-addressing hash table (linear probing) keyed on the process name
+ * packed into a uint64_t. A PCB is indexed while it sits in one of the four queues, which
+ * matches the set of PCBs find_pcb() used to reach by walking the queues.
+ */
+typedef struct {
+    uint64_t key;
+    PCB *pcb; // NULL marks an empty slot
+} IndexSlot;
+
+#define INDEX_MIN_CAPACITY 64
+
+static IndexSlot *g_index = NULL;
+static size_t g_index_capacity = 0; // always a power of two
+static size_t g_index_count = 0;
+
 /**
- * @brief Allocates memory for a new PCB (Process Control Block).
- * @return Pointer to the newly allocated PCB, or NULL if allocation fails.
+ * @brief Packs a process name (at most 8 characters) into a 64-bit key.
+ * @param p_name Name of the process.
+ * @return The packed key.
  */
-PCB *allocate_pcb(void) {
-    PCB *newPCB = malloc(sizeof(PCB));
+static uint64_t pack_name(const char *p_name) {
+    /* The key holds the name's bytes zero-padded, not a C string: an 8-character name fills it
+     * without a terminator, so every distinct name gets a distinct key. */
+    char buf[8] = {0};
+    memcpy(buf, p_name, strnlen(p_name, sizeof(buf)));
+    uint64_t key;
+    memcpy(&key, buf, sizeof(key));
+    return key;
+}
 
-    if (newPCB == NULL) {
-        return NULL;
+/**
+ * @brief Returns the home slot of a key.
+ */
+static size_t index_home(const uint64_t key) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (g_index_capacity - 1);
+}
+
+/**
+ * @brief Finds the slot holding a key.
+ * @return Pointer to the slot, or NULL if the key is not indexed.
+ */
+static IndexSlot *index_find(const uint64_t key) {
+    if (!g_index) return NULL;
+    for (size_t i = index_home(key);; i = (i + 1) & (g_index_capacity - 1)) {
+        if (!g_index[i].pcb) return NULL;
+        if (g_index[i].key == key) return &g_index[i];
+    }
+}
+
+/**
+ * @brief Inserts or replaces an entry without checking the load factor.
+ */
+static void index_place(const uint64_t key, PCB *p) {
+    size_t i = index_home(key);
+    while (g_index[i].pcb && g_index[i].key != key) i = (i + 1) & (g_index_capacity - 1);
+    if (!g_index[i].pcb) g_index_count++;
+    g_index[i].key = key;
+    g_index[i].pcb = p;
+}
+
+/**
+ * @brief Doubles the table (or creates it) and rehashes every entry.
+ * @return 0 on success, -1 if allocation fails.
+ */
+static int index_grow(void) {
+    const size_t old_capacity = g_index_capacity;
+    IndexSlot *old = g_index;
+    const size_t capacity = old_capacity ? old_capacity * 2 : INDEX_MIN_CAPACITY;
+
+    IndexSlot *table = calloc(capacity, sizeof(IndexSlot));
+    if (!table) return -1;
+
+    g_index = table;
+    g_index_capacity = capacity;
+    g_index_count = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].pcb) index_place(old[i].key, old[i].pcb);
     }
-    memset(newPCB, 0, sizeof(PCB)); // Initialize the PCB to zero
+    free(old);
+    return 0;
+}
 
-    return newPCB;
+/**
+ * @brief Adds a PCB to the name index, keeping the load factor at or below 1/2.
+ * @param p Pointer to the PCB.
+ */
+static void index_put(PCB *p) {
+    if ((g_index_count + 1) * 2 > g_index_capacity && index_grow() != 0) {
+        if (!g_index || g_index_count + 1 >= g_index_capacity) return; // out of memory and no room left
+    }
+    index_place(pack_name(p->p_name), p);
 }
 
 /**
- * @brief Frees the memory allocated for a PCB.
+ * @brief Removes a PCB from the name index.
+ * @details Uses backward-shift deletion so no tombstones are left behind.
+ * @param p Pointer to the PCB.
+ */
+static void index_erase(const PCB *p) {
+    IndexSlot *slot = index_find(pack_name(p->p_name));
+    if (!slot || slot->pcb != p) return;
+
+    const size_t mask = g_index_capacity - 1;
+    size_t hole = (size_t)(slot - g_index);
+    for (size_t i = (hole + 1) & mask; g_index[i].pcb; i = (i + 1) & mask) {
+        const size_t home = index_home(g_index[i].key);
+        /* move the entry back if its home slot is not in (hole, i] */
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            g_index[hole] = g_index[i];
+            hole = i;
+        }
+    }
+    g_index[hole].pcb = NULL;
+    g_index[hole].key = 0;
+    g_index_count--;
+}
+
+/**
+ * @brief Initializes the PCB pool. Must be called before any PCB is allocated.
+ */
+void init_pcbs(void) {
+    pool_init(&g_pcb_pool, sizeof(PCB), PCB_CACHE_LINE, PCBS_PER_SLAB);
+    pool_init(&g_ext_pool, sizeof(PCBExt), 0, PCBS_PER_SLAB);
+}
+
+/**
+ * @brief Allocates memory for a new PCB (Process Control Block) from the PCB pool.
+ * @return Pointer to the newly allocated, zeroed PCB with a zeroed PCBExt attached, or NULL if allocation fails.
+ */
+PCB *allocate_pcb(void) {
+    PCB *p = pool_alloc(&g_pcb_pool);
+    if (!p) return NULL;
+    p->ext = pool_alloc(&g_ext_pool);
+    if (!p->ext) {
+        pool_free(&g_pcb_pool, p);
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * @brief Returns a PCB to the PCB pool.
  * @param p Pointer to the PCB to be freed.
  * @return 0 on success, -1 if the pointer is NULL.
  */
 int free_pcb(PCB *p) {
     if (!p) return -1;
-    free(p);
+    acct_record(p);
+    index_erase(p);
+    waitchan_cancel(p);
+    edf_detach(p);
+    Owner *owner = owner_get(p->ext->owner);
+    if (owner) owner->pcbs--;
+    image_release(p->image);
+    output_release(p->sink);
+    pool_free(&g_ext_pool, p->ext);
+    pool_free(&g_pcb_pool, p);
     return 0;
 }
 
@@ -37,8 +188,10 @@ int free_pcb(PCB *p) {
  * @param p Pointer to the PCB to be inserted.
  */
 void insert_pcb(PCB *p) {
+    index_put(p);
     if (p->state == READY && !p->suspended) {
-        enqueue_ready(p);
+        schedstats_on_ready(p);
+        scheduler_enqueue(p);
     } else if (p->state == BLOCKED && !p->suspended) {
         enqueue_blocked(p);
     } else if (p-> state == READY && p->suspended) {
@@ -49,15 +202,28 @@ void insert_pcb(PCB *p) {
 }
 
 /**
- * @brief Sets up a PCB with the given parameters.
+ * @brief Sets up a PCB with the given parameters. The PCB is owned by the logged-in user.
  * @param p_name Name of the process (up to 8 characters + '\0').
  * @param p_class Process class (0 for system, 1 for application).
  * @param priority Priority of the process (0-9).
+ * @param image Registered process image, or NO_IMAGE for none. The PCB takes over the caller's reference.
+ * @param deadline_ms Relative deadline of each job of a system-class process in milliseconds, 0 for none.
  * @return Pointer to the newly created PCB, or NULL if allocation fails.
  */
-PCB *setup_pcb(const char *p_name, const int p_class, const int priority, const char *file_path) {
+PCB *setup_pcb(const char *p_name, const int p_class, const int priority, const ImageId image, const unsigned int deadline_ms) {
     PCB *p = allocate_pcb();
     if (!p) return NULL;
+    p->ext->owner = owner_current();
+    Owner *owner = owner_get(p->ext->owner);
+    if (!owner) {
+        free_pcb(p);
+        return NULL;
+    }
+    owner->pcbs++;
+    if (deadline_ms && edf_attach(p, deadline_ms) != 0) {
+        free_pcb(p); // still holds no image, so the caller keeps its reference
+        return NULL;
+    }
 
     strncpy(p->p_name, p_name, 8);
     p->p_name[8] = '\0';
@@ -65,38 +231,24 @@ PCB *setup_pcb(const char *p_name, const int p_class, const int priority, const
     p->priority = priority;
     p->state = READY;
     p->suspended = false;
-    strncpy(p->file_path, file_path, PATH_MAX-1);
+    p->image = image;
     p->offset = 0;
 
+    schedstats_on_create(p);
     insert_pcb(p);
     return p;
 }
 
 /**
- * @brief Finds a PCB by its name in the ready and blocked queues.
+ * @brief Finds a PCB by its name in any of the four queues.
+ * @details Looks the name up in the hash index, so the cost does not depend on queue sizes.
  * @param p_name Name of the process to search for.
  * @return Pointer to the PCB if found, NULL otherwise.
  */
 PCB *find_pcb(const char *p_name) {
-    PCB *p;
-
-    /* search ready queue */
-    for (p = g_ready_queue.head; p; p = p->next)
-        if (strcmp(p->p_name, p_name) == 0) return p;
-
-    /* search blocked queue */
-    for (p = g_blocked_queue.head; p; p = p->next)
-        if (strcmp(p->p_name, p_name) == 0) return p;
-
-    /* search suspended ready queue */
-    for (p = g_suspended_ready_queue.head; p; p = p->next)
-        if (strcmp(p->p_name, p_name) == 0) return p;
-
-    /* search suspended blocked queue */
-    for (p = g_suspended_blocked_queue.head; p; p = p->next)
-        if (strcmp(p->p_name, p_name) == 0) return p;
-
-    return NULL;
+    if (strlen(p_name) > 8) return NULL; // longer names can never be stored
+    const IndexSlot *slot = index_find(pack_name(p_name));
+    return slot ? slot->pcb : NULL;
 }
 
 /**
@@ -106,9 +258,10 @@ PCB *find_pcb(const char *p_name) {
  */
 int remove_pcb(PCB *p) {
     if (!p) return -1;
+    index_erase(p);
 
     if (p->state == READY && !p->suspended)
-        dequeue(&g_ready_queue, p);
+        scheduler_remove(p);
     else if (p->state == BLOCKED && !p->suspended)
         dequeue(&g_blocked_queue, p);
     else if (p->state == READY && p->suspended)
@@ -119,3 +272,26 @@ int remove_pcb(PCB *p) {
     return 0;
 }
 
+
+/**
+ * @brief Gets the PCB pool, for reporting its occupancy counters.
+ * @return A constant pointer to the pool.
+ */
+const Pool *get_pcb_pool(void) {
+    return &g_pcb_pool;
+}
+
+/**
+ * @brief Destroys every PCB at once.
+ * @details Empties the queues, drops the name index and releases all pool slabs in bulk instead of
+ * freeing PCBs one by one. Image references are not dropped; the registry is torn down separately.
+ */
+void cleanup_pcbs(void) {
+    init_queues();
+    free(g_index);
+    g_index = NULL;
+    g_index_capacity = 0;
+    g_index_count = 0;
+    pool_reset(&g_pcb_pool);
+    pool_reset(&g_ext_pool);
+}
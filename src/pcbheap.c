@@ -0,0 +1,114 @@
+#include "pcbheap.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Capacity of a heap's first allocation. */
+#define HEAP_MIN_CAPACITY 64
+
+/**
+ * @brief Tells whether entry a must leave the heap before entry b.
+ */
+static int entry_before(const HeapEntry *a, const HeapEntry *b) {
+    return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+/**
+ * @brief Stores an entry at a position and records the position in its PCB.
+ */
+static void place(PCBHeap *heap, const uint32_t i, const HeapEntry *entry) {
+    heap->entries[i] = *entry;
+    entry->pcb->ext->heap_index = i;
+}
+
+/**
+ * @brief Moves the entry at a position up until its parent leaves the heap before it.
+ */
+static void sift_up(PCBHeap *heap, uint32_t i) {
+    const HeapEntry entry = heap->entries[i];
+    while (i > 0) {
+        const uint32_t parent = (i - 1) / 2;
+        if (!entry_before(&entry, &heap->entries[parent])) break;
+        place(heap, i, &heap->entries[parent]);
+        i = parent;
+    }
+    place(heap, i, &entry);
+}
+
+/**
+ * @brief Moves the entry at a position down until both children leave the heap after it.
+ */
+static void sift_down(PCBHeap *heap, uint32_t i) {
+    const HeapEntry entry = heap->entries[i];
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && entry_before(&heap->entries[child + 1], &heap->entries[child])) child++;
+        if (!entry_before(&heap->entries[child], &entry)) break;
+        place(heap, i, &heap->entries[child]);
+        i = child;
+    }
+    place(heap, i, &entry);
+}
+
+/**
+ * @brief Files a PCB in a heap under a key.
+ * @param heap The heap.
+ * @param p Pointer to the PCB. It must not be filed in any heap.
+ * @param key Key of the PCB; the smallest key is at the top.
+ * @return 0 on success, -1 if the heap could not grow.
+ */
+int pcbheap_push(PCBHeap *heap, PCB *p, const uint64_t key) {
+    if (heap->count == heap->capacity) {
+        const uint32_t capacity = heap->capacity ? heap->capacity * 2 : HEAP_MIN_CAPACITY;
+        HeapEntry *entries = realloc(heap->entries, capacity * sizeof(HeapEntry));
+        if (!entries) return -1;
+        heap->entries = entries;
+        heap->capacity = capacity;
+    }
+    const HeapEntry entry = { key, heap->seq++, p };
+    place(heap, heap->count++, &entry);
+    sift_up(heap, heap->count - 1);
+    return 0;
+}
+
+/**
+ * @brief Returns the PCB with the smallest key without removing it.
+ * @return Pointer to the PCB, or NULL if the heap is empty.
+ */
+PCB *pcbheap_top(const PCBHeap *heap) {
+    return heap->count ? heap->entries[0].pcb : NULL;
+}
+
+/**
+ * @brief Returns the smallest key in a heap, or 0 if the heap is empty.
+ */
+uint64_t pcbheap_top_key(const PCBHeap *heap) {
+    return heap->count ? heap->entries[0].key : 0;
+}
+
+/**
+ * @brief Removes a PCB from a heap in O(log n).
+ * @param heap The heap.
+ * @param p Pointer to the PCB. Nothing happens if it is not filed in this heap.
+ */
+void pcbheap_remove(PCBHeap *heap, PCB *p) {
+    const uint32_t i = p->ext->heap_index;
+    if (i >= heap->count || heap->entries[i].pcb != p) return;
+
+    const HeapEntry last = heap->entries[--heap->count];
+    if (i == heap->count) return;
+    place(heap, i, &last);
+    if (i > 0 && entry_before(&last, &heap->entries[(i - 1) / 2])) {
+        sift_up(heap, i);
+    } else {
+        sift_down(heap, i);
+    }
+}
+
+/**
+ * @brief Empties a heap and releases its memory.
+ */
+void pcbheap_clear(PCBHeap *heap) {
+    free(heap->entries);
+    memset(heap, 0, sizeof(PCBHeap));
+}
@@ -0,0 +1,94 @@
+#include "pool.h"
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Rounds a size up to a multiple of an alignment, which must be a power of two. */
+#define ALIGN_UP(size, alignment) (((size) + (alignment) - 1) & ~((alignment) - 1))
+
+/* Objects start after the slab header, which is padded to the pool's alignment. */
+#define SLAB_HEADER_SIZE(pool) ALIGN_UP(sizeof(PoolSlab), (pool)->alignment)
+
+/**
+ * @brief Initializes an empty pool. No memory is allocated until the first pool_alloc().
+ * @param pool Pointer to the pool.
+ * @param object_size Size of each object in bytes.
+ * @param alignment Alignment of every object: a power of two, or 0 for alignof(max_align_t). A cache line
+ * size keeps each object of at most that size within a single line.
+ * @param per_slab Number of objects carved from each slab.
+ */
+void pool_init(Pool *pool, size_t object_size, size_t alignment, const size_t per_slab) {
+    if (alignment < alignof(max_align_t)) alignment = alignof(max_align_t);
+    if (object_size < sizeof(void *)) object_size = sizeof(void *);
+    object_size = ALIGN_UP(object_size, alignment);
+
+    memset(pool, 0, sizeof(Pool));
+    pool->object_size = object_size;
+    pool->alignment = alignment;
+    pool->per_slab = per_slab;
+    pool->bump = per_slab; // forces a slab allocation on first use
+}
+
+/**
+ * @brief Allocates a zeroed object, reusing freed objects before carving new ones.
+ * @param pool Pointer to the pool.
+ * @return Pointer to the object, or NULL if a new slab could not be allocated.
+ */
+void *pool_alloc(Pool *pool) {
+    void *object;
+
+    if (pool->free_list) {
+        object = pool->free_list;
+        memcpy(&pool->free_list, object, sizeof(void *));
+    } else {
+        if (pool->bump == pool->per_slab) {
+            void *memory;
+            if (posix_memalign(&memory, pool->alignment, SLAB_HEADER_SIZE(pool) + pool->object_size * pool->per_slab) != 0) {
+                return NULL;
+            }
+            PoolSlab *slab = memory;
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->slab_count++;
+            pool->bump = 0;
+        }
+        object = (unsigned char *)pool->slabs + SLAB_HEADER_SIZE(pool) + pool->object_size * pool->bump++;
+    }
+
+    memset(object, 0, pool->object_size);
+    if (++pool->in_use > pool->high_water) pool->high_water = pool->in_use;
+    return object;
+}
+
+/**
+ * @brief Returns an object to the pool's free list.
+ * @param pool Pointer to the pool.
+ * @param object Pointer to an object allocated from this pool.
+ */
+void pool_free(Pool *pool, void *object) {
+    memcpy(object, &pool->free_list, sizeof(void *));
+    pool->free_list = object;
+    pool->in_use--;
+}
+
+/**
+ * @brief Releases every slab at once. All objects from the pool become invalid.
+ * @param pool Pointer to the pool.
+ */
+void pool_reset(Pool *pool) {
+    PoolSlab *slab = pool->slabs;
+    while (slab) {
+        PoolSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    pool_init(pool, pool->object_size, pool->alignment, pool->per_slab);
+}
+
+/**
+ * @brief Returns the number of objects the allocated slabs can hold.
+ * @param pool Pointer to the pool.
+ */
+size_t pool_capacity(const Pool *pool) {
+    return pool->slab_count * pool->per_slab;
+}
@@ -1,6 +1,7 @@
 #include "queue.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 Queue g_ready_queue;
 Queue g_blocked_queue;
@@ -12,51 +13,63 @@ Queue g_suspended_blocked_queue;
  * Sets the count to 0 and head/tail pointers to NULL.
  */
 void init_queues(void) {
-    g_ready_queue.count = 0; g_ready_queue.head = g_ready_queue.tail = NULL;
-    g_blocked_queue.count = 0; g_blocked_queue.head = g_blocked_queue.tail = NULL;
-    g_suspended_ready_queue.count = 0; g_suspended_ready_queue.head = g_suspended_ready_queue.tail = NULL;
-    g_suspended_blocked_queue.count = 0; g_suspended_blocked_queue.head = g_suspended_blocked_queue.tail = NULL;
+    memset(&g_ready_queue, 0, sizeof(Queue));
+    memset(&g_blocked_queue, 0, sizeof(Queue));
+    memset(&g_suspended_ready_queue, 0, sizeof(Queue));
+    memset(&g_suspended_blocked_queue, 0, sizeof(Queue));
 }
 
 /**
- * @brief Enqueues a PCB into the ready queue in descending priority order.
- * If the queue is empty, the PCB becomes both head and tail.
- * Otherwise, it finds the correct position based on priority.
+ * @brief Enqueues a PCB at the tail of a level of a priority-ordered queue, in O(1).
+ * @details The PCB is linked after the last PCB of its own level, or after the last PCB of the
+ * nearest higher non-empty level found through the level bitmap. The list order is the same
+ * as a linear insertion walk would produce. The level is recorded in the PCB for dequeue().
+ * @param q Pointer to a priority-ordered queue.
  * @param p Pointer to the PCB to be enqueued.
+ * @param level Level to file the PCB under: a priority (0-9) or REALTIME_LEVEL.
  */
-void enqueue_ready(PCB *p) {
-    // insert by descending priority
-    Queue *q = &g_ready_queue;
-    if (!q->head) {
-        q->head = q->tail = p;
-        p->next = p->prev = NULL;
+void queue_push_level(Queue *q, PCB *p, const int level) {
+    p->level = (uint8_t)level;
+    const unsigned int higher = (unsigned int)q->levels >> (level + 1);
+
+    PCB *after;
+    if (q->level_tail[level]) {
+        after = q->level_tail[level];
+    } else if (higher) {
+        after = q->level_tail[level + 1 + __builtin_ctz(higher)];
     } else {
-        PCB *cur = q->head;
-        while (cur && cur->priority >= p->priority) cur = cur->next;
-        if (!cur) {
-            // insert at tail
-            p->prev = q->tail;
-            p->next = NULL;
-            q->tail->next = p;
-            q->tail = p;
-        } else {
-            // insert before current
-            p->next = cur;
-            p->prev = cur->prev;
-            if (cur->prev) cur->prev->next = p; else q->head = p;
-            cur->prev = p;
-        }
+        after = NULL; // highest priority present, goes to the front
     }
+
+    p->prev = after;
+    p->next = after ? after->next : q->head;
+    if (p->prev) p->prev->next = p; else q->head = p;
+    if (p->next) p->next->prev = p; else q->tail = p;
+
+    if (!q->level_head[level]) q->level_head[level] = p;
+    q->level_tail[level] = p;
+    q->level_count[level]++;
+    q->levels |= (uint16_t)(1u << level);
     q->count++;
 }
 
 /**
- * @brief Enqueues a PCB into the blocked queue in FIFO order.
+ * @brief Enqueues a PCB in descending priority order, FIFO within a priority level, in O(1).
+ * @param q Pointer to a priority-ordered queue.
+ * @param p Pointer to the PCB to be enqueued.
+ */
+void queue_push_priority(Queue *q, PCB *p) {
+    queue_push_level(q, p, p->priority);
+}
+
+/**
+ * @brief Appends a PCB to a queue in FIFO order.
  * If the queue is empty, the PCB becomes both head and tail.
+ * @param q Pointer to the queue.
  * @param p Pointer to the PCB to be enqueued.
  */
-void enqueue_blocked(PCB *p) {
-    Queue *q = &g_blocked_queue;
+void queue_push_back(Queue *q, PCB *p) {
+    p->level = NO_LEVEL;
     p->next = NULL;
     p->prev = q->tail;
     if (q->tail) q->tail->next = p;
@@ -65,51 +78,29 @@ void enqueue_blocked(PCB *p) {
     q->count++;
 }
 
+/**
+ * @brief Enqueues a PCB into the blocked queue in FIFO order.
+ * @param p Pointer to the PCB to be enqueued.
+ */
+void enqueue_blocked(PCB *p) {
+    queue_push_back(&g_blocked_queue, p);
+}
+
 /**
  * @brief Enqueues a PCB into the suspended ready queue in descending priority order.
- * @details If the queue is empty, the PCB becomes both head and tail.
- * Otherwise, it finds the correct position based on priority.
+ * @details Uses the per-priority buckets of the queue, so insertion is O(1).
  * @param p Pointer to the PCB to be enqueued.
  */
 void enqueue_suspended_ready(PCB *p) {
-    // insert by descending priority
-    Queue *q = &g_suspended_ready_queue;
-    if (!q->head) {
-        q->head = q->tail = p;
-        p->next = p->prev = NULL;
-    } else {
-        PCB *cur = q->head;
-        while (cur && cur->priority >= p->priority) cur = cur->next;
-        if (!cur) {
-            // insert at tail
-            p->prev = q->tail;
-            p->next = NULL;
-            q->tail->next = p;
-            q->tail = p;
-        } else {
-            // insert before current
-            p->next = cur;
-            p->prev = cur->prev;
-            if (cur->prev) cur->prev->next = p; else q->head = p;
-            cur->prev = p;
-        }
-    }
-    q->count++;
+    queue_push_priority(&g_suspended_ready_queue, p);
 }
 
 /**
  * @brief Enqueues a PCB into the suspended blocked queue in FIFO order.
- * @details If the queue is empty, the PCB becomes both head and tail.
  * @param p Pointer to the PCB to be enqueued.
  */
 void enqueue_suspended_blocked(PCB *p) {
-    Queue *q = &g_suspended_blocked_queue;
-    p->next = NULL;
-    p->prev = q->tail;
-    if (q->tail) q->tail->next = p;
-    else q->head = p;
-    q->tail = p;
-    q->count++;
+    queue_push_back(&g_suspended_blocked_queue, p);
 }
 
 /**
@@ -120,12 +111,43 @@ void enqueue_suspended_blocked(PCB *p) {
  */
 void dequeue(Queue *q, PCB *p) {
     if (!p || !q->head) return;
+
+    /* keep the priority buckets in sync (FIFO queues have no levels set) */
+    const int level = p->level;
+    if (level < QUEUE_LEVELS && (q->levels & (1u << level))) {
+        q->level_count[level]--;
+        if (q->level_head[level] == p && q->level_tail[level] == p) {
+            q->level_head[level] = q->level_tail[level] = NULL;
+            q->levels &= (uint16_t)~(1u << level);
+        } else if (q->level_head[level] == p) {
+            q->level_head[level] = p->next;
+        } else if (q->level_tail[level] == p) {
+            q->level_tail[level] = p->prev;
+        }
+    }
+
     if (p->prev) p->prev->next = p->next; else q->head = p->next;
     if (p->next) p->next->prev = p->prev; else q->tail = p->prev;
     p->next = p->prev = NULL;
     q->count--;
 }
 
+/**
+ * @brief Returns the first PCB of the highest non-empty priority level without removing it.
+ * @details The level is found with a count-leading-zeros on the level bitmap.
+ * @param q Pointer to a priority-ordered queue.
+ * @return Pointer to the PCB, or NULL if the queue is empty.
+ */
+PCB *peek_highest(const Queue *q) {
+    if (!q->levels) return NULL;
+    return q->level_head[31 - __builtin_clz((unsigned int)q->levels)];
+}
+
+/**
+ * @brief Prints every PCB of a queue in queue order.
+ * @param title Heading printed above the queue.
+ * @param q Pointer to the queue.
+ */
 void dump_queue(const char *title, Queue *q) {
     printf("================================ %s (%d) ==============================\n", title, q->count);
     int count = 0;
@@ -152,7 +174,5 @@ void cleanup_queue(Queue *q) {
         free_pcb(current);
         current = next;
     }
-    q->head = NULL;
-    q->tail = NULL;
-    q->count = 0;
+    memset(q, 0, sizeof(Queue));
 }
@@ -0,0 +1,55 @@
+#include "resusage.h"
+#include <string.h>
+
+/**
+ * @brief Converts a timeval to microseconds.
+ */
+static uint64_t timeval_us(const struct timeval *tv) {
+    return (uint64_t)tv->tv_sec * 1000000ULL + (uint64_t)tv->tv_usec;
+}
+
+/**
+ * @brief Computes the usage between two getrusage() samples of the same thread or process.
+ * @param before Sample taken before the slice, or NULL if after covers only the slice (a reaped child).
+ * @param after Sample taken after the slice.
+ * @param usage Receives the CPU time and context switches in between. The resident set high-water mark is
+ * only kept when after covers the slice alone: between two samples of a thread or process that outlives
+ * the slice, it is the whole process's peak so far, so it is recorded as 0, meaning unavailable.
+ */
+void resusage_between(const struct rusage *before, const struct rusage *after, ResourceUsage *usage) {
+    struct rusage zero;
+    if (!before) {
+        memset(&zero, 0, sizeof(zero));
+        before = &zero;
+    }
+    usage->utime_us = timeval_us(&after->ru_utime) - timeval_us(&before->ru_utime);
+    usage->stime_us = timeval_us(&after->ru_stime) - timeval_us(&before->ru_stime);
+    usage->maxrss_kb = before == &zero && after->ru_maxrss > 0 ? (uint64_t)after->ru_maxrss : 0;
+    usage->nvcsw = (uint64_t)(after->ru_nvcsw - before->ru_nvcsw);
+    usage->nivcsw = (uint64_t)(after->ru_nivcsw - before->ru_nivcsw);
+}
+
+/**
+ * @brief Replaces the CPU time of a usage with a more precise total, split between user and system time
+ * in the ratio getrusage() reported.
+ * @details getrusage() samples CPU time at clock ticks, so a slice shorter than a tick often reads as 0.
+ * The split is all user time when getrusage() saw none.
+ * @param usage The usage to correct.
+ * @param cpu_us CPU time used, from a CPU-time clock.
+ */
+void resusage_set_cpu(ResourceUsage *usage, const uint64_t cpu_us) {
+    const uint64_t sampled = usage->utime_us + usage->stime_us;
+    usage->stime_us = sampled ? (uint64_t)((double)cpu_us * (double)usage->stime_us / (double)sampled) : 0;
+    usage->utime_us = cpu_us - usage->stime_us;
+}
+
+/**
+ * @brief Adds the usage of a slice to a total. CPU time and context switches add up; the resident set keeps its maximum.
+ */
+void resusage_add(ResourceUsage *total, const ResourceUsage *usage) {
+    total->utime_us += usage->utime_us;
+    total->stime_us += usage->stime_us;
+    if (usage->maxrss_kb > total->maxrss_kb) total->maxrss_kb = usage->maxrss_kb;
+    total->nvcsw += usage->nvcsw;
+    total->nivcsw += usage->nivcsw;
+}
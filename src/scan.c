@@ -0,0 +1,241 @@
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+#include "imgindex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+/*
+ * Interrupt byte scanner and image decoder.
+ * Finding the next interrupt byte is the innermost loop of every time slice, and decoding is the
+ * innermost loop of process output. The kernels are picked once at startup from the vector
+ * extensions the CPU supports: AVX2, then SSE2, then a portable word-at-a-time (SWAR) loop. Every
+ * kernel returns exactly what the byte-by-byte loop it replaces would.
+ */
+
+/* Images are encoded by adding this to every byte. */
+#define ENCODING_SHIFT 5
+
+/**
+ * @brief Reference kernel: examines one byte at a time.
+ */
+static const unsigned char *scan_bytewise(const unsigned char *data, const size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == INTERRUPT_BYTE) return data + i;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reference decoder: subtracts the shift one byte at a time.
+ */
+static void decode_bytewise(unsigned char *dst, const unsigned char *src, const size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = (unsigned char)(src[i] - ENCODING_SHIFT);
+}
+
+/**
+ * @brief Portable kernel: tests eight bytes per step with the "has zero byte" bit trick.
+ * @details Bytes equal to the interrupt byte become zero after the XOR. The trick can flag a byte
+ * above a real match, but never one below it, so the lowest flagged byte is always exact.
+ */
+static const unsigned char *scan_swar(const unsigned char *data, const size_t len) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t pattern = ones * INTERRUPT_BYTE;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        word ^= pattern;
+        const uint64_t found = (word - ones) & ~word & highs;
+        if (found) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return data + i + (size_t)(__builtin_clzll(found) / 8);
+#else
+            return data + i + (size_t)(__builtin_ctzll(found) / 8);
+#endif
+        }
+    }
+    return scan_bytewise(data + i, len - i);
+}
+
+/**
+ * @brief Portable decoder: subtracts the shift from eight bytes per step.
+ * @details The high bit of every byte is set before subtracting so no borrow can cross into the
+ * next byte, and is then corrected with an XOR, giving a per-byte subtraction modulo 256.
+ */
+static void decode_swar(unsigned char *dst, const unsigned char *src, const size_t len) {
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t shift = 0x0101010101010101ULL * ENCODING_SHIFT;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        word = ((word | highs) - shift) ^ ((word ^ ~shift) & highs);
+        memcpy(dst + i, &word, sizeof(word));
+    }
+    decode_bytewise(dst + i, src + i, len - i);
+}
+
+#ifdef SCAN_X86
+/**
+ * @brief SSE2 kernel: compares 16 bytes per step.
+ */
+__attribute__((target("sse2")))
+static const unsigned char *scan_sse2(const unsigned char *data, const size_t len) {
+    const __m128i pattern = _mm_set1_epi8((char)INTERRUPT_BYTE);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        if (mask) return data + i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+    return scan_swar(data + i, len - i);
+}
+
+/**
+ * @brief SSE2 decoder: subtracts the shift from 16 bytes per step.
+ */
+__attribute__((target("sse2")))
+static void decode_sse2(unsigned char *dst, const unsigned char *src, const size_t len) {
+    const __m128i shift = _mm_set1_epi8(ENCODING_SHIFT);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_sub_epi8(block, shift));
+    }
+    decode_swar(dst + i, src + i, len - i);
+}
+
+/**
+ * @brief AVX2 kernel: compares 64 bytes per step as two 32-byte blocks.
+ */
+__attribute__((target("avx2")))
+static const unsigned char *scan_avx2(const unsigned char *data, const size_t len) {
+    const __m256i pattern = _mm256_set1_epi8((char)INTERRUPT_BYTE);
+
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        const __m256i lo = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), pattern);
+        const __m256i hi = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 32)), pattern);
+        if (!_mm256_testz_si256(_mm256_or_si256(lo, hi), _mm256_or_si256(lo, hi))) {
+            const uint64_t mask = (uint32_t)_mm256_movemask_epi8(lo) |
+                                  (uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32;
+            return data + i + (size_t)__builtin_ctzll(mask);
+        }
+    }
+    for (; i + 32 <= len; i += 32) {
+        const __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), pattern);
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(eq);
+        if (mask) return data + i + (size_t)__builtin_ctz(mask);
+    }
+    return scan_sse2(data + i, len - i);
+}
+
+/**
+ * @brief AVX2 decoder: subtracts the shift from 32 bytes per step.
+ */
+__attribute__((target("avx2")))
+static void decode_avx2(unsigned char *dst, const unsigned char *src, const size_t len) {
+    const __m256i shift = _mm256_set1_epi8(ENCODING_SHIFT);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_sub_epi8(block, shift));
+    }
+    decode_sse2(dst + i, src + i, len - i);
+}
+#endif
+
+/* Every kernel, fastest first. scan_kernel() only hands out those the CPU supports. */
+static const ScanKernel g_kernels[] = {
+#ifdef SCAN_X86
+    { "avx2", scan_avx2, decode_avx2 },
+    { "sse2", scan_sse2, decode_sse2 },
+#endif
+    { "swar", scan_swar, decode_swar },
+    { "bytewise", scan_bytewise, decode_bytewise },
+};
+
+static const ScanKernel *g_supported[sizeof(g_kernels) / sizeof(g_kernels[0])];
+static size_t g_supported_count = 0;
+static const ScanKernel *g_selected = &g_kernels[sizeof(g_kernels) / sizeof(g_kernels[0]) - 2]; // swar
+
+/**
+ * @brief Checks whether the CPU can run a kernel.
+ */
+static int kernel_supported(const ScanKernel *k) {
+#ifdef SCAN_X86
+    if (k->scan == scan_avx2) return __builtin_cpu_supports("avx2");
+    if (k->scan == scan_sse2) return __builtin_cpu_supports("sse2");
+#endif
+    (void)k;
+    return 1;
+}
+
+/**
+ * @brief Selects the fastest supported kernel before main() runs.
+ * @details Running as a constructor means the selection is finished before any dispatcher worker
+ * thread can call scan_interrupt().
+ */
+__attribute__((constructor))
+static void select_kernel(void) {
+#ifdef SCAN_X86
+    __builtin_cpu_init(); // required before __builtin_cpu_supports() in a constructor
+#endif
+    for (size_t i = 0; i < sizeof(g_kernels) / sizeof(g_kernels[0]); i++) {
+        if (kernel_supported(&g_kernels[i])) g_supported[g_supported_count++] = &g_kernels[i];
+    }
+    g_selected = g_supported[0];
+}
+
+/**
+ * @brief Finds the first interrupt byte in a buffer with the selected kernel.
+ * @param data Start of the buffer.
+ * @param len Length of the buffer in bytes.
+ * @return Pointer to the first interrupt byte, or NULL if there is none.
+ */
+const unsigned char *scan_interrupt(const unsigned char *data, const size_t len) {
+    return g_selected->scan(data, len);
+}
+
+/**
+ * @brief Decodes encoded image bytes with the selected kernel.
+ * @param dst Destination buffer of at least len bytes; may equal src.
+ * @param src Encoded bytes.
+ * @param len Number of bytes to decode.
+ */
+void scan_decode(unsigned char *dst, const unsigned char *src, const size_t len) {
+    g_selected->decode(dst, src, len);
+}
+
+/**
+ * @brief Returns the name of the kernels scan_interrupt() and scan_decode() use.
+ */
+const char *scan_kernel_name(void) {
+    return g_selected->name;
+}
+
+/**
+ * @brief Returns the number of kernels the CPU supports.
+ */
+size_t scan_kernel_count(void) {
+    return g_supported_count;
+}
+
+/**
+ * @brief Gets a supported kernel, fastest first.
+ * @param i Index from 0 to scan_kernel_count() - 1.
+ * @return The kernel, or NULL if the index is out of range.
+ */
+const ScanKernel *scan_kernel(const size_t i) {
+    return i < g_supported_count ? g_supported[i] : NULL;
+}
@@ -0,0 +1,138 @@
+#include "schedstats.h"
+#include <string.h>
+#include "utils.h"
+
+static Histogram g_stats[STAT_METRICS][STATS_GROUPS];
+
+/* When collection started: the first PCB created or the last reset. 0 before either. */
+static uint64_t g_since_us = 0;
+
+/**
+ * @brief Returns the bucket a value falls in.
+ * @details Below STATS_SUB_BUCKETS the value is its own bucket. Above, the bucket is picked by the position of
+ * the highest set bit and the STATS_SUB_BUCKET_BITS bits after it.
+ */
+static int bucket_of(uint64_t value) {
+    const uint64_t largest = (2ULL << STATS_MAX_MAGNITUDE) - 1;
+    if (value > largest) value = largest;
+    if (value < STATS_SUB_BUCKETS) return (int)value;
+    const int magnitude = 63 - __builtin_clzll(value);
+    const int shift = magnitude - STATS_SUB_BUCKET_BITS;
+    return (shift + 1) * STATS_SUB_BUCKETS + (int)((value >> shift) & (STATS_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Returns the largest value that falls in a bucket.
+ */
+static uint64_t bucket_highest(const int bucket) {
+    if (bucket < STATS_SUB_BUCKETS) return (uint64_t)bucket;
+    const int shift = bucket / STATS_SUB_BUCKETS - 1;
+    const uint64_t lowest = (uint64_t)(STATS_SUB_BUCKETS + bucket % STATS_SUB_BUCKETS) << shift;
+    return lowest + (1ULL << shift) - 1;
+}
+
+static void histogram_record(Histogram *h, const uint64_t value) {
+    if (h->count == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->count++;
+    h->sum += value;
+    h->buckets[bucket_of(value)]++;
+}
+
+/**
+ * @brief Records a value of a metric for all PCBs, the PCB's priority and the PCB's class.
+ */
+static void record(const SchedMetric metric, const PCB *p, const uint64_t value) {
+    histogram_record(&g_stats[metric][STATS_GROUP_ALL], value);
+    histogram_record(&g_stats[metric][STATS_GROUP_PRIORITY(p->priority)], value);
+    histogram_record(&g_stats[metric][STATS_GROUP_CLASS(p->p_class)], value);
+}
+
+/**
+ * @brief Stamps a new PCB with its creation time. Called before the PCB is inserted in a queue.
+ */
+void schedstats_on_create(PCB *p) {
+    const uint64_t now = monotonic_us();
+    if (g_since_us == 0) g_since_us = now;
+    p->ext->created_us = now;
+}
+
+/**
+ * @brief Stamps a PCB that joins the ready queue, so its wait can be measured when it is dispatched.
+ */
+void schedstats_on_ready(PCB *p) {
+    p->ext->ready_us = monotonic_us();
+}
+
+/**
+ * @brief Records how long a PCB waited in the ready queue, and its response time if this is its first slice.
+ * @param p Pointer to the PCB, just taken off the ready queue to run a slice.
+ */
+void schedstats_on_dispatch(PCB *p) {
+    const uint64_t now = monotonic_us();
+    PCBExt *ext = p->ext;
+    record(STAT_WAIT, p, now - ext->ready_us);
+    if (ext->slices == 0) {
+        record(STAT_RESPONSE, p, now - ext->created_us);
+    }
+    ext->slices++;
+}
+
+/**
+ * @brief Records the turnaround time and slice count of a PCB that completed or failed.
+ * @param p Pointer to the PCB, about to be freed.
+ */
+void schedstats_on_exit(const PCB *p) {
+    record(STAT_TURNAROUND, p, monotonic_us() - p->ext->created_us);
+    record(STAT_SLICES, p, p->ext->slices);
+}
+
+/**
+ * @brief Returns the histogram of a metric for a group of PCBs.
+ * @param metric The metric.
+ * @param group STATS_GROUP_ALL, STATS_GROUP_PRIORITY(priority) or STATS_GROUP_CLASS(class).
+ */
+const Histogram *schedstats_get(const SchedMetric metric, const int group) {
+    return &g_stats[metric][group];
+}
+
+/**
+ * @brief Returns the seconds since collection started, 0 if nothing was collected yet.
+ */
+double schedstats_elapsed(void) {
+    return g_since_us ? (double)(monotonic_us() - g_since_us) / 1e6 : 0.0;
+}
+
+/**
+ * @brief Empties every histogram and restarts collection now. PCBs keep their timestamps.
+ */
+void schedstats_reset(void) {
+    memset(g_stats, 0, sizeof(g_stats));
+    g_since_us = monotonic_us();
+}
+
+/**
+ * @brief Returns the value below or at which a percentage of the recorded values fall.
+ * @details The result is the largest value of the bucket the percentile falls in, capped at the largest
+ * value recorded, so it overstates the exact percentile by less than 1/16.
+ * @param h The histogram.
+ * @param percentile The percentage, 0 to 100.
+ * @return The value, or 0 if the histogram is empty.
+ */
+uint64_t histogram_percentile(const Histogram *h, const double percentile) {
+    if (h->count == 0) return 0;
+    const double exact = percentile / 100.0 * (double)h->count;
+    uint64_t rank = (uint64_t)exact;
+    if ((double)rank < exact || rank == 0) rank++;
+    if (rank > h->count) rank = h->count;
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < STATS_BUCKETS; bucket++) {
+        seen += h->buckets[bucket];
+        if (seen >= rank) {
+            const uint64_t highest = bucket_highest(bucket);
+            return highest < h->max ? highest : h->max;
+        }
+    }
+    return h->max;
+}
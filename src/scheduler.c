@@ -0,0 +1,408 @@
+#include "scheduler.h"
+#include <string.h>
+#include <time.h>
+#include "queue.h"
+#include "pcbheap.h"
+#include "edf.h"
+#include "owner.h"
+
+/* Stride of a PCB with a single ticket; a PCB with n tickets advances its pass by STRIDE_ONE / n per slice. */
+#define STRIDE_ONE (1ULL << 20)
+
+static SchedPolicyId g_policy_id = SCHED_PRIORITY;
+static SjfBasis g_sjf_basis = SJF_REMAINING;
+
+/* Ready PCBs ordered by the SJF or stride key. */
+static PCBHeap g_heap;
+
+/* Stride scheduling: pass of the last PCB that ran. PCBs joining the ready queue start no earlier. */
+static uint64_t g_virtual_time = 0;
+
+/* Fair share: virtual runtime of the last owner that ran. Owners whose PCBs become ready again start no earlier. */
+static uint64_t g_fair_time = 0;
+
+static uint64_t g_rng_state = 0;
+
+/* MLFQ: slices a level may be passed over for while it holds ready PCBs before its oldest PCB is promoted. */
+static unsigned int g_mlfq_aging = MLFQ_DEFAULT_AGING;
+
+/* MLFQ: per-level epoch, advanced each time a slice runs at a higher level while the level has ready PCBs. */
+static uint32_t g_level_epoch[PRIORITY_LEVELS];
+
+/**
+ * @brief Returns the number of lottery tickets, or the stride share, of a PCB.
+ */
+static unsigned int tickets(const PCB *p) {
+    return p->priority + 1u;
+}
+
+/**
+ * @brief Returns a uniformly distributed 64-bit number from a xorshift64* generator.
+ */
+static uint64_t next_random(void) {
+    if (g_rng_state == 0) g_rng_state = (uint64_t)time(NULL) ^ 0x9E3779B97F4A7C15ULL;
+    g_rng_state ^= g_rng_state >> 12;
+    g_rng_state ^= g_rng_state << 25;
+    g_rng_state ^= g_rng_state >> 27;
+    return g_rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* --- priority --- */
+
+static void priority_enqueue(PCB *p) {
+    queue_push_priority(&g_ready_queue, p);
+}
+
+static void list_remove(PCB *p) {
+    dequeue(&g_ready_queue, p);
+}
+
+static PCB *priority_pick_next(void) {
+    return peek_highest(&g_ready_queue);
+}
+
+/* --- fifo --- */
+
+static void fifo_enqueue(PCB *p) {
+    queue_push_back(&g_ready_queue, p);
+}
+
+static PCB *fifo_pick_next(void) {
+    return g_ready_queue.head;
+}
+
+/* --- sjf and stride: the list is kept in arrival order and the heap picks --- */
+
+static void heap_remove(PCB *p) {
+    pcbheap_remove(&g_heap, p);
+    dequeue(&g_ready_queue, p);
+}
+
+/**
+ * @brief Returns the PCB at the top of the heap.
+ * @details Falls back to the oldest ready PCB if the heap could not grow to hold every ready PCB.
+ */
+static PCB *heap_pick_next(void) {
+    PCB *p = pcbheap_top(&g_heap);
+    return p ? p : g_ready_queue.head;
+}
+
+/**
+ * @brief Returns the length of a PCB's job by the current SJF basis.
+ */
+static uint64_t job_length(const PCB *p) {
+    const ProcessImage *img = image_get(p->image);
+    if (!img) return 0;
+    if (g_sjf_basis == SJF_SIZE || p->offset >= img->size) return (uint64_t)img->size;
+    return (uint64_t)(img->size - p->offset);
+}
+
+static void sjf_enqueue(PCB *p) {
+    queue_push_back(&g_ready_queue, p);
+    pcbheap_push(&g_heap, p, job_length(p));
+}
+
+static void stride_enqueue(PCB *p) {
+    if (p->ext->pass < g_virtual_time) p->ext->pass = g_virtual_time;
+    queue_push_back(&g_ready_queue, p);
+    pcbheap_push(&g_heap, p, p->ext->pass);
+}
+
+static void stride_on_tick(PCB *p, const bool preempted) {
+    (void)preempted;
+    if (p->ext->pass > g_virtual_time) g_virtual_time = p->ext->pass;
+    p->ext->pass += STRIDE_ONE / tickets(p);
+}
+
+/* --- lottery: tickets are drawn per priority level, and the winning level runs its oldest PCB --- */
+
+/**
+ * @brief Draws the winning ticket among all ready PCBs.
+ * @details Every PCB of level n holds n + 1 tickets, so a level wins in proportion to its PCB count
+ * times n + 1. Its PCBs then take turns, which gives each PCB its share of wins in O(levels) per draw.
+ */
+static PCB *lottery_pick_next(void) {
+    uint64_t total = 0;
+    for (int level = 0; level < PRIORITY_LEVELS; level++) {
+        total += (uint64_t)g_ready_queue.level_count[level] * (uint64_t)(level + 1);
+    }
+    if (total == 0) return NULL;
+
+    uint64_t ticket = next_random() % total;
+    for (int level = PRIORITY_LEVELS - 1; level >= 0; level--) {
+        const uint64_t held = (uint64_t)g_ready_queue.level_count[level] * (uint64_t)(level + 1);
+        if (ticket < held) return g_ready_queue.level_head[level];
+        ticket -= held;
+    }
+    return NULL;
+}
+
+/* --- mlfq: demoted for using a full quantum, boosted for blocking, aged lazily through per-level epochs --- */
+
+/**
+ * @brief Files a PCB at the tail of its MLFQ level and records the level's epoch.
+ */
+static void mlfq_enqueue(PCB *p) {
+    const int level = MLFQ_TOP_LEVEL - p->ext->depth;
+    p->ext->epoch = g_level_epoch[level];
+    queue_push_level(&g_ready_queue, p, level);
+}
+
+/**
+ * @brief Promotes PCBs that waited too long, then returns the first PCB of the highest level.
+ * @details A level's epoch only advances while the level is passed over, so the PCB that has waited
+ * longest at a level is its head, and only heads need checking. Levels are checked top down, so a PCB
+ * moves up at most one level per decision; each promotion is O(1) and there are at most MLFQ_TOP_LEVEL per
+ * PCB between enqueues, so aging costs amortized O(1) however many PCBs are waiting.
+ */
+static PCB *mlfq_pick_next(void) {
+    for (int level = MLFQ_TOP_LEVEL - 1; level >= 0; level--) {
+        PCB *p;
+        while ((p = g_ready_queue.level_head[level]) && g_level_epoch[level] - p->ext->epoch >= g_mlfq_aging) {
+            dequeue(&g_ready_queue, p);
+            p->ext->depth--;
+            mlfq_enqueue(p);
+        }
+    }
+    return peek_highest(&g_ready_queue);
+}
+
+/**
+ * @brief Advances the epoch of every non-empty level below the one the slice ran at, and demotes
+ * a PCB that used up its quantum.
+ */
+static void mlfq_on_tick(PCB *p, const bool preempted) {
+    const int level = MLFQ_TOP_LEVEL - p->ext->depth;
+    const unsigned int below = (unsigned int)g_ready_queue.levels & ((1u << level) - 1);
+    for (unsigned int bits = below; bits; bits &= bits - 1) {
+        g_level_epoch[__builtin_ctz(bits)]++;
+    }
+    if (preempted && p->ext->depth < MLFQ_TOP_LEVEL) p->ext->depth++;
+}
+
+/**
+ * @brief Boosts a PCB that blocked on I/O by one level.
+ */
+static void mlfq_on_block(PCB *p) {
+    if (p->ext->depth > 0) p->ext->depth--;
+}
+
+/* --- fairshare: owners take turns by virtual runtime, and each runs its highest-priority PCB first --- */
+
+/**
+ * @brief Files a PCB in the ready queue by priority and in its owner's heap.
+ * @details An owner with no ready PCB left is not credited for the time it waited: its virtual
+ * runtime is brought up to that of the last owner that ran, like a task waking up under CFS.
+ */
+static void fair_enqueue(PCB *p) {
+    Owner *owner = owner_get(p->ext->owner);
+    if (owner->ready.count == 0 && owner->vruntime < g_fair_time) owner->vruntime = g_fair_time;
+    queue_push_priority(&g_ready_queue, p);
+    pcbheap_push(&owner->ready, p, (uint64_t)(PRIORITY_LEVELS - 1 - p->priority));
+}
+
+static void fair_remove(PCB *p) {
+    pcbheap_remove(&owner_get(p->ext->owner)->ready, p);
+    dequeue(&g_ready_queue, p);
+}
+
+/**
+ * @brief Returns the highest-priority ready PCB of the owner with the smallest virtual runtime.
+ * @details Owners are few, one per account that created PCBs, so they are scanned in O(owners); ties go
+ * to the owner registered first. Falls back to the oldest ready PCB if a heap could not grow.
+ */
+static PCB *fair_pick_next(void) {
+    const Owner *next = NULL;
+    for (OwnerId id = 1; id <= owner_count(); id++) {
+        const Owner *owner = owner_get(id);
+        if (owner->ready.count && (!next || owner->vruntime < next->vruntime)) next = owner;
+    }
+    return next ? pcbheap_top(&next->ready) : g_ready_queue.head;
+}
+
+/**
+ * @brief Charges a slice to the owner of a PCB: FAIRSHARE_SLICE divided by the weight of the owner's role.
+ */
+static void fair_on_tick(PCB *p, const bool preempted) {
+    (void)preempted;
+    Owner *owner = owner_get(p->ext->owner);
+    if (owner->vruntime > g_fair_time) g_fair_time = owner->vruntime;
+    owner->vruntime += FAIRSHARE_SLICE / owner_weight(owner);
+}
+
+static const SchedPolicy g_policies[SCHED_POLICIES] = {
+    [SCHED_PRIORITY]  = { "priority", priority_enqueue, list_remove, priority_pick_next, NULL, NULL, NULL },
+    [SCHED_FIFO]      = { "fifo", fifo_enqueue, list_remove, fifo_pick_next, NULL, NULL, NULL },
+    [SCHED_SJF]       = { "sjf", sjf_enqueue, heap_remove, heap_pick_next, NULL, NULL, NULL },
+    [SCHED_LOTTERY]   = { "lottery", priority_enqueue, list_remove, lottery_pick_next, NULL, NULL, NULL },
+    [SCHED_STRIDE]    = { "stride", stride_enqueue, heap_remove, heap_pick_next, stride_on_tick, NULL, NULL },
+    [SCHED_MLFQ]      = { "mlfq", mlfq_enqueue, list_remove, mlfq_pick_next, mlfq_on_tick, mlfq_on_block, NULL },
+    [SCHED_FAIRSHARE] = { "fairshare", fair_enqueue, fair_remove, fair_pick_next, fair_on_tick, NULL, NULL },
+};
+
+/**
+ * @brief Files every ready PCB again under the current policy.
+ * @details The ready queue list is detached and emptied first, so each PCB is filed exactly once.
+ */
+static void refile_ready(void) {
+    PCB *p = g_ready_queue.head;
+    memset(&g_ready_queue, 0, sizeof(Queue));
+    pcbheap_clear(&g_heap);
+    for (OwnerId id = 1; id <= owner_count(); id++) {
+        pcbheap_clear(&owner_get(id)->ready);
+    }
+    edf_clear_ready();
+    while (p) {
+        PCB *next = p->next;
+        scheduler_enqueue(p);
+        p = next;
+    }
+}
+
+/**
+ * @brief Selects the scheduling policy. PCBs already in the ready queue are filed under the new policy.
+ * @param id The policy.
+ */
+void scheduler_set_policy(const SchedPolicyId id) {
+    g_policy_id = id;
+    refile_ready();
+}
+
+/**
+ * @brief Gets the current scheduling policy.
+ */
+SchedPolicyId scheduler_get_policy(void) {
+    return g_policy_id;
+}
+
+/**
+ * @brief Returns the name of a scheduling policy.
+ */
+const char *scheduler_policy_name(const SchedPolicyId id) {
+    return id < SCHED_POLICIES ? g_policies[id].name : "unknown";
+}
+
+/**
+ * @brief Parses a scheduling policy name.
+ * @param str The string to parse.
+ * @param id Pointer to store the parsed policy.
+ * @return 1 if valid, 0 otherwise.
+ */
+int scheduler_parse_policy(const char *str, SchedPolicyId *id) {
+    for (int i = 0; i < SCHED_POLICIES; i++) {
+        if (strcmp(str, g_policies[i].name) == 0) {
+            *id = (SchedPolicyId)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Selects what the SJF policy measures a job by. Ready PCBs are filed again if SJF is in use.
+ * @param basis The basis.
+ */
+void scheduler_set_sjf_basis(const SjfBasis basis) {
+    g_sjf_basis = basis;
+    if (g_policy_id == SCHED_SJF) refile_ready();
+}
+
+/**
+ * @brief Gets what the SJF policy measures a job by.
+ */
+SjfBasis scheduler_get_sjf_basis(void) {
+    return g_sjf_basis;
+}
+
+/**
+ * @brief Sets how many slices an MLFQ level may be passed over before its oldest PCB is promoted.
+ * @param slices The aging threshold, at least 1.
+ */
+void scheduler_set_mlfq_aging(const unsigned int slices) {
+    g_mlfq_aging = slices;
+}
+
+/**
+ * @brief Gets the MLFQ aging threshold in slices.
+ */
+unsigned int scheduler_get_mlfq_aging(void) {
+    return g_mlfq_aging;
+}
+
+/**
+ * @brief Files a PCB that became ready in the ready queue.
+ * @param p Pointer to the PCB.
+ */
+void scheduler_enqueue(PCB *p) {
+    if (p->ext->edf) {
+        edf_enqueue(p);
+        return;
+    }
+    g_policies[g_policy_id].enqueue(p);
+}
+
+/**
+ * @brief Takes a PCB out of the ready queue.
+ * @param p Pointer to the PCB.
+ */
+void scheduler_remove(PCB *p) {
+    if (p->ext->edf) {
+        edf_remove(p);
+        return;
+    }
+    g_policies[g_policy_id].remove(p);
+}
+
+/**
+ * @brief Returns the ready PCB that should run next, without removing it.
+ * @details PCBs with a deadline run ahead of every other PCB, earliest deadline first. The policy
+ * only picks among the others.
+ * @return Pointer to the PCB, or NULL if the ready queue is empty.
+ */
+PCB *scheduler_pick_next(void) {
+    if (!g_ready_queue.head) return NULL;
+    PCB *p = edf_pick_next();
+    return p ? p : g_policies[g_policy_id].pick_next();
+}
+
+/**
+ * @brief Counts a slice of a PCB against its owner and tells the policy that the slice finished executing.
+ * @param p Pointer to the PCB, not in any queue.
+ * @param preempted Whether the slice ran out of its quantum.
+ */
+void scheduler_on_tick(PCB *p, const bool preempted) {
+    Owner *owner = owner_get(p->ext->owner);
+    if (owner) owner->slices++;
+    if (p->ext->edf) {
+        edf_on_tick(p, preempted);
+        return;
+    }
+    if (g_policies[g_policy_id].on_tick) g_policies[g_policy_id].on_tick(p, preempted);
+}
+
+/**
+ * @brief Tells the policy that a PCB was interrupted and waits for its I/O.
+ * @param p Pointer to the PCB, not in any queue.
+ */
+void scheduler_on_block(PCB *p) {
+    if (p->ext->edf) return;
+    if (g_policies[g_policy_id].on_block) g_policies[g_policy_id].on_block(p);
+}
+
+/**
+ * @brief Tells the policy that a PCB completed or failed and is about to be freed.
+ * @param p Pointer to the PCB, not in any queue.
+ */
+void scheduler_on_complete(PCB *p) {
+    if (p->ext->edf) return;
+    if (g_policies[g_policy_id].on_complete) g_policies[g_policy_id].on_complete(p);
+}
+
+/**
+ * @brief Releases the policy's index of ready PCBs.
+ * @details The index only holds pointers, so cleanup_techos() releases it before cleanup_pcbs() frees the
+ * PCBs, right after waitchan_cleanup().
+ */
+void scheduler_cleanup(void) {
+    pcbheap_clear(&g_heap);
+}
@@ -0,0 +1,198 @@
+#include "timewheel.h"
+#include <string.h>
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+/**
+ * @brief Returns the slot index a tick falls into at a level.
+ */
+static unsigned int slot_index(const uint64_t tick, const int level) {
+    return (unsigned int)(tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+}
+
+/**
+ * @brief Appends a timer to a slot list.
+ */
+static void link_timer(TimeWheel *wheel, Timer *timer, const int level, const unsigned int index) {
+    TimerList *list = &wheel->slots[level][index];
+    timer->next = NULL;
+    timer->prev = list->tail;
+    if (list->tail) list->tail->next = timer; else list->head = timer;
+    list->tail = timer;
+    timer->slot = (int16_t)(level * WHEEL_SLOTS + (int)index);
+    wheel->occupied[level] |= 1ULL << index;
+}
+
+/**
+ * @brief Detaches the whole list of a slot.
+ * @return The first timer of the list, still linked to the others through next.
+ */
+static Timer *take_slot(TimeWheel *wheel, const int level, const unsigned int index) {
+    TimerList *list = &wheel->slots[level][index];
+    Timer *head = list->head;
+    list->head = list->tail = NULL;
+    wheel->occupied[level] &= ~(1ULL << index);
+    return head;
+}
+
+/**
+ * @brief Links a timer into the level that covers its distance from the current tick.
+ */
+static void place_timer(TimeWheel *wheel, Timer *timer) {
+    const uint64_t delta = timer->expires - wheel->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >> (WHEEL_BITS * (level + 1))) level++;
+    link_timer(wheel, timer, level, slot_index(timer->expires, level));
+}
+
+/**
+ * @brief Moves the timers of the upper-level slots that begin at the current tick one or more levels down.
+ * @details Called whenever level 0 wraps. Level n is cascaded only if every level below it wrapped too.
+ */
+static void cascade(TimeWheel *wheel) {
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        const unsigned int index = slot_index(wheel->now, level);
+        Timer *timer = take_slot(wheel, level, index);
+        while (timer) {
+            Timer *next = timer->next;
+            place_timer(wheel, timer);
+            timer = next;
+        }
+        if (index != 0) break;
+    }
+}
+
+/**
+ * @brief Initializes an empty wheel.
+ * @param wheel Pointer to the wheel.
+ * @param now The current tick.
+ */
+void timewheel_init(TimeWheel *wheel, const uint64_t now) {
+    memset(wheel, 0, sizeof(TimeWheel));
+    wheel->now = now;
+}
+
+/**
+ * @brief Arms a timer.
+ * @details A timer that is already due fires on the next advance. Expiry times more than
+ * WHEEL_MAX_DELAY ticks ahead are clamped to that.
+ * @param wheel Pointer to the wheel.
+ * @param timer The timer. It must not be armed.
+ * @param expires Tick at which the timer fires.
+ */
+void timewheel_add(TimeWheel *wheel, Timer *timer, uint64_t expires) {
+    if (expires < wheel->now) expires = wheel->now;
+    if (expires - wheel->now > WHEEL_MAX_DELAY) expires = wheel->now + WHEEL_MAX_DELAY;
+    timer->expires = expires;
+    place_timer(wheel, timer);
+    wheel->count++;
+}
+
+/**
+ * @brief Disarms a timer. Does nothing if it is not armed.
+ * @param wheel Pointer to the wheel.
+ * @param timer The timer.
+ */
+void timewheel_cancel(TimeWheel *wheel, Timer *timer) {
+    if (timer->slot < 0) return;
+    const int level = timer->slot / WHEEL_SLOTS;
+    const unsigned int index = (unsigned int)timer->slot % WHEEL_SLOTS;
+    TimerList *list = &wheel->slots[level][index];
+
+    if (timer->prev) timer->prev->next = timer->next; else list->head = timer->next;
+    if (timer->next) timer->next->prev = timer->prev; else list->tail = timer->prev;
+    if (!list->head) wheel->occupied[level] &= ~(1ULL << index);
+
+    timer->next = timer->prev = NULL;
+    timer->slot = -1;
+    wheel->count--;
+}
+
+/**
+ * @brief Fires every timer that expires up to and including a tick.
+ * @details Ticks with nothing to fire or cascade are skipped with the slot bitmaps, so the cost does
+ * not grow with the time elapsed. Timers of the same tick fire in the order they were added. The
+ * callback may add or cancel timers.
+ * @param wheel Pointer to the wheel.
+ * @param now The current tick.
+ * @param fire Called for each expired timer, after it has been disarmed.
+ * @param ctx Passed to the callback.
+ * @return Number of timers fired.
+ */
+size_t timewheel_advance(TimeWheel *wheel, const uint64_t now, const TimerCallback fire, void *ctx) {
+    size_t fired = 0;
+    while (wheel->now <= now) {
+        if (wheel->count == 0) {
+            wheel->now = now + 1;
+            break;
+        }
+
+        const unsigned int index = slot_index(wheel->now, 0);
+        if (index == 0) cascade(wheel);
+
+        const uint64_t pending = wheel->occupied[0] >> index;
+        if (!pending) {
+            const uint64_t wrap = (wheel->now | WHEEL_MASK) + 1;
+            wheel->now = wrap <= now ? wrap : now + 1;
+            continue;
+        }
+        const uint64_t tick = wheel->now + (uint64_t)__builtin_ctzll(pending);
+        if (tick > now) {
+            wheel->now = now + 1;
+            break;
+        }
+
+        /* Step past the tick first, so timers the callback adds for it are placed for the next one. */
+        wheel->now = tick + 1;
+        Timer *timer = take_slot(wheel, 0, slot_index(tick, 0));
+        while (timer) {
+            Timer *next = timer->next;
+            timer->next = timer->prev = NULL;
+            timer->slot = -1;
+            wheel->count--;
+            fire(timer, ctx);
+            fired++;
+            timer = next;
+        }
+    }
+    return fired;
+}
+
+/**
+ * @brief Returns the next tick at which timewheel_advance() has work to do.
+ * @details This is the expiry tick of the earliest timer in level 0, or the tick at which the
+ * next non-empty upper-level slot is cascaded, whichever comes first. It never lies after the
+ * earliest expiry.
+ * @param wheel Pointer to the wheel.
+ * @return The tick, or UINT64_MAX if no timer is armed.
+ */
+uint64_t timewheel_next_event(const TimeWheel *wheel) {
+    if (wheel->count == 0) return UINT64_MAX;
+
+    uint64_t next = UINT64_MAX;
+    const unsigned int index = slot_index(wheel->now, 0);
+    const uint64_t pending = wheel->occupied[0] >> index;
+    if (pending) {
+        next = wheel->now + (uint64_t)__builtin_ctzll(pending);
+    } else if (wheel->occupied[0]) {
+        /* only slots behind the current one are in use: they are due in the next lap */
+        next = (wheel->now | WHEEL_MASK) + 1 + (uint64_t)__builtin_ctzll(wheel->occupied[0]);
+    }
+
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) continue;
+        const int shift = WHEEL_BITS * level;
+        const unsigned int current = slot_index(wheel->now, level);
+        /* Slots are cascaded when the tick reaches their start, so the current slot is next due one lap later,
+         * unless its start is the current tick itself. */
+        const uint64_t start = (wheel->now >> shift) << shift;
+        for (unsigned int step = start == wheel->now ? 0 : 1; step <= WHEEL_SLOTS; step++) {
+            if (wheel->occupied[level] & (1ULL << ((current + step) & WHEEL_MASK))) {
+                const uint64_t tick = start + ((uint64_t)step << shift);
+                if (tick < next) next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
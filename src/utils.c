@@ -56,6 +56,18 @@ void get_current_time_str(char *buffer, size_t size) {
     strftime(buffer, size, "%H:%M:%S", prog_time);
 }
 
+/**
+ * @brief Reads CLOCK_MONOTONIC in microseconds.
+ * @details The one clock behind scheduling statistics, EDF deadlines, the wakeup wheel and the
+ * slice quantum, so their timestamps can be compared with each other.
+ * @return Microseconds since an arbitrary fixed point; never goes backwards.
+*/
+uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
 /**
  * @brief Checks if a year is a leap year.
  * @param year The year to check.
@@ -195,16 +207,30 @@ int validate_class(const char *str, int *p_class) {
 
 /**
  * @brief function to validate a file path.
- * This function checks if the path is not NULL, has a length between 1 and 8,
- * and contains only alphanumeric characters.
+ * This function checks that the file exists and is readable. Paths up to PATH_MAX are accepted.
  * @param file_path the file path to be validated
  * @return returns 1 if valid, 0 otherwise
  */
 int validate_file_path(const char *file_path) {
-    char full_path[256];
-    snprintf(full_path, sizeof(full_path), "%s", file_path);
-    if (access(full_path, R_OK) != 0) {
-        printf("%sError: No file present at %s --> %s%s\n", RED, full_path, strerror(errno), RESET);
+    if (access(file_path, R_OK) != 0) {
+        printf("%sError: No file present at %s --> %s%s\n", RED, file_path, strerror(errno), RESET);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief function to build the path of a process image from its name.
+ * This function appends the ".techos" extension and rejects paths longer than PATH_MAX.
+ * @param name the image name as typed by the user
+ * @param buf the buffer that receives the path, at least PATH_MAX bytes
+ * @param size the size of the buffer
+ * @return returns 1 if the path fits, 0 otherwise
+ */
+int build_image_path(const char *name, char *buf, const size_t size) {
+    const int n = snprintf(buf, size, "%s.techos", name);
+    if (n < 0 || (size_t)n >= size) {
+        printf("%sError: File path is longer than %zu characters.%s\n", RED, size - 1, RESET);
         return 0;
     }
     return 1;
@@ -0,0 +1,412 @@
+#ifdef __linux__
+#define _GNU_SOURCE // pipe2
+#endif
+#include "waitchan.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
+#include "pcb.h"
+#include "pool.h"
+#include "timewheel.h"
+#include "utils.h"
+#include "color_library.h"
+
+/* Number of wakeup timers carved from each slab of the timer pool. */
+#define TIMERS_PER_SLAB 256
+
+/*
+ * A wait channel counts the wakeups posted to it on an eventfd (a non-blocking pipe holding one
+ * byte per wakeup where eventfd is unavailable). The dispatcher sleeps on every channel at once
+ * with epoll (poll elsewhere) and, for each wakeup, moves the oldest PCB parked on the channel
+ * back to the ready queue. Wakeups posted while no PCB is parked are dropped.
+ */
+typedef struct {
+    const char *name;
+    Queue *queue;        // FIFO queue holding the PCBs parked on the channel
+    int read_fd;         // -1 while the channels are closed
+    int write_fd;        // same descriptor as read_fd for an eventfd
+    unsigned long pending; // wakeups posted and not yet delivered
+} WaitChannel;
+
+static WaitChannel g_channels[WAIT_CHANNELS] = {
+    { "event", &g_blocked_queue, -1, -1, 0 },
+    { "io", &g_suspended_blocked_queue, -1, -1, 0 },
+    { "resume", &g_suspended_ready_queue, -1, -1, 0 },
+};
+
+#ifdef __linux__
+static int g_epoll_fd = -1;
+#endif
+
+/*
+ * Wakeup deadlines of blocked PCBs, in a timing wheel ticking in milliseconds of CLOCK_MONOTONIC.
+ * A PCB whose deadline passes is woken directly, whatever its position in its queue.
+ */
+#define WHEEL_NOW() (monotonic_us() / 1000)
+static TimeWheel g_wheel;
+static Pool g_timer_pool;
+static bool g_wheel_ready = false;
+
+static IoLatency g_latency = { LATENCY_NONE, 0, 0 };
+static uint64_t g_rng_state = 0;
+
+/**
+ * @brief Returns the channel a PCB is parked on, from the queue its state places it in.
+ */
+static WaitChannelId channel_of(const PCB *p) {
+    if (p->state == BLOCKED) return p->suspended ? WAIT_IO : WAIT_EVENT;
+    return WAIT_RESUME;
+}
+
+/**
+ * @brief Creates the descriptor pair of a channel.
+ * @return 0 on success, -1 on failure.
+ */
+static int open_channel(WaitChannel *ch) {
+#ifdef __linux__
+    ch->read_fd = ch->write_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    return ch->read_fd == -1 ? -1 : 0;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) return -1;
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+    ch->read_fd = fds[0];
+    ch->write_fd = fds[1];
+    return 0;
+#endif
+}
+
+/**
+ * @brief Opens every wait channel. Called when a dispatch starts.
+ * @return 0 on success, -1 if the channels could not be created.
+ */
+int waitchan_open(void) {
+#ifdef __linux__
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epoll_fd == -1) return -1;
+#endif
+    for (int i = 0; i < WAIT_CHANNELS; i++) {
+        WaitChannel *ch = &g_channels[i];
+        ch->pending = 0;
+        if (open_channel(ch) == -1) {
+            waitchan_close();
+            return -1;
+        }
+#ifdef __linux__
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = ch };
+        epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, ch->read_fd, &ev);
+#endif
+    }
+    return 0;
+}
+
+/**
+ * @brief Closes every wait channel, dropping undelivered wakeups.
+ */
+void waitchan_close(void) {
+    for (int i = 0; i < WAIT_CHANNELS; i++) {
+        WaitChannel *ch = &g_channels[i];
+        if (ch->read_fd != -1) close(ch->read_fd);
+        if (ch->write_fd != -1 && ch->write_fd != ch->read_fd) close(ch->write_fd);
+        ch->read_fd = ch->write_fd = -1;
+        ch->pending = 0;
+    }
+#ifdef __linux__
+    if (g_epoll_fd != -1) close(g_epoll_fd);
+    g_epoll_fd = -1;
+#endif
+}
+
+/**
+ * @brief Returns the command-line name of a channel.
+ */
+const char *waitchan_name(const WaitChannelId id) {
+    return g_channels[id].name;
+}
+
+/**
+ * @brief Posts wakeups to a channel.
+ * @param id The channel.
+ * @param count Number of parked PCBs to wake.
+ */
+void waitchan_post(const WaitChannelId id, const unsigned int count) {
+    WaitChannel *ch = &g_channels[id];
+    if (ch->write_fd == -1 || count == 0) return;
+#ifdef __linux__
+    const uint64_t value = count;
+    if (write(ch->write_fd, &value, sizeof(value)) != sizeof(value)) return;
+#else
+    char bytes[64];
+    memset(bytes, 1, sizeof(bytes));
+    unsigned int left = count;
+    while (left > 0) {
+        const ssize_t n = write(ch->write_fd, bytes, left < sizeof(bytes) ? left : sizeof(bytes));
+        if (n <= 0) break; // a full pipe already guarantees a wakeup
+        left -= (unsigned int)n;
+    }
+#endif
+    ch->pending += count;
+}
+
+/**
+ * @brief Returns the number of wakeups posted to any channel and not yet delivered.
+ */
+unsigned long waitchan_pending(void) {
+    unsigned long pending = 0;
+    for (int i = 0; i < WAIT_CHANNELS; i++) {
+        pending += g_channels[i].pending;
+    }
+    return pending;
+}
+
+/**
+ * @brief Reads and resets the wakeup count of a signalled channel.
+ */
+static unsigned long drain_channel(const WaitChannel *ch) {
+#ifdef __linux__
+    uint64_t value = 0;
+    return read(ch->read_fd, &value, sizeof(value)) == sizeof(value) ? (unsigned long)value : 0;
+#else
+    unsigned long total = 0;
+    char bytes[64];
+    ssize_t n;
+    while ((n = read(ch->read_fd, bytes, sizeof(bytes))) > 0) {
+        total += (unsigned long)n;
+    }
+    return total;
+#endif
+}
+
+/**
+ * @brief Moves a parked PCB back to the ready queue, dropping its wakeup deadline.
+ * @param p Pointer to the PCB.
+ * @param reason Printed after the PCB's name.
+ */
+static void wake_pcb(PCB *p, const char *reason) {
+    waitchan_cancel(p);
+    remove_pcb(p);
+    p->state = READY;
+    p->suspended = false; // Always resume when unblocking
+    insert_pcb(p);
+    printf("%sDispatcher: Woke '%s' (%s).%s\n", CYAN, p->p_name, reason, RESET);
+}
+
+/**
+ * @brief Wakes the PCB of an expired deadline.
+ * @param timer The expired timer.
+ * @param ctx Pointer to the count of woken PCBs.
+ */
+static void fire_deadline(Timer *timer, void *ctx) {
+    PCB *p = timer->data;
+    char reason[32];
+    snprintf(reason, sizeof(reason), "%s deadline", g_channels[channel_of(p)].name);
+    wake_pcb(p, reason);
+    (*(int *)ctx)++;
+}
+
+/**
+ * @brief Delivers the wakeups of a signalled channel to the PCBs parked on it, oldest first.
+ * @return Number of PCBs moved to the ready queue.
+ */
+static int deliver(WaitChannel *ch) {
+    unsigned long wakeups = drain_channel(ch);
+    ch->pending = ch->pending > wakeups ? ch->pending - wakeups : 0;
+
+    int woken = 0;
+    while (wakeups > 0 && ch->queue->head) {
+        wake_pcb(ch->queue->head, ch->name);
+        wakeups--;
+        woken++;
+    }
+    return woken;
+}
+
+/**
+ * @brief Waits for wakeups on every channel and for wakeup deadlines, and delivers them.
+ * @details A sleep is cut short when the timing wheel has a deadline to fire or a slot to cascade.
+ * Without posted wakeups and with a zero timeout, only the expired deadlines are delivered.
+ * @param timeout_ms Maximum time to sleep in milliseconds: 0 returns at once, -1 sleeps until a
+ * channel is signalled or a deadline passes.
+ * @return Number of PCBs moved to the ready queue.
+ */
+int waitchan_dispatch(int timeout_ms) {
+    int woken = 0;
+    if (timeout_ms != 0 && waitchan_sleeping() > 0) {
+        const uint64_t next = timewheel_next_event(&g_wheel);
+        const uint64_t now = WHEEL_NOW();
+        const uint64_t wait = next > now ? next - now : 0;
+        if (timeout_ms < 0 || wait < (uint64_t)timeout_ms) {
+            timeout_ms = wait > INT_MAX ? INT_MAX : (int)wait;
+        }
+    }
+
+    if (timeout_ms != 0 || waitchan_pending() > 0) {
+#ifdef __linux__
+        struct epoll_event events[WAIT_CHANNELS];
+        int n;
+        while ((n = epoll_wait(g_epoll_fd, events, WAIT_CHANNELS, timeout_ms)) == -1 && errno == EINTR) {}
+        /* Deliver in channel order, so a stall wakeup and I/O completions are handled the same way every time. */
+        bool signalled[WAIT_CHANNELS] = { false };
+        for (int i = 0; i < n; i++) {
+            signalled[(WaitChannel *)events[i].data.ptr - g_channels] = true;
+        }
+        for (int i = 0; i < WAIT_CHANNELS; i++) {
+            if (signalled[i]) woken += deliver(&g_channels[i]);
+        }
+#else
+        struct pollfd pfds[WAIT_CHANNELS];
+        for (int i = 0; i < WAIT_CHANNELS; i++) {
+            pfds[i] = (struct pollfd){ .fd = g_channels[i].read_fd, .events = POLLIN };
+        }
+        while (poll(pfds, WAIT_CHANNELS, timeout_ms) == -1 && errno == EINTR) {}
+        for (int i = 0; i < WAIT_CHANNELS; i++) {
+            if (pfds[i].revents & POLLIN) woken += deliver(&g_channels[i]);
+        }
+#endif
+    }
+
+    if (waitchan_sleeping() > 0) {
+        timewheel_advance(&g_wheel, WHEEL_NOW(), fire_deadline, &woken);
+    }
+    return woken;
+}
+
+/**
+ * @brief Sets or replaces the wakeup deadline of a parked PCB.
+ * @details Deadlines that passed while no dispatch was running are delivered first, so the wheel
+ * is caught up with the clock before the new one is added.
+ * @param p Pointer to a PCB in the blocked, suspended-blocked or suspended-ready queue.
+ * @param ms Milliseconds from now, clamped to WHEEL_MAX_DELAY.
+ * @return 0 on success, -1 if no timer could be allocated.
+ */
+int waitchan_sleep(PCB *p, const unsigned int ms) {
+    const uint64_t now = WHEEL_NOW();
+    if (!g_wheel_ready) {
+        timewheel_init(&g_wheel, now);
+        pool_init(&g_timer_pool, sizeof(Timer), 0, TIMERS_PER_SLAB);
+        g_wheel_ready = true;
+    }
+    int woken = 0;
+    timewheel_advance(&g_wheel, now, fire_deadline, &woken);
+
+    waitchan_cancel(p);
+    Timer *timer = pool_alloc(&g_timer_pool);
+    if (!timer) return -1;
+    timer->data = p;
+    timer->slot = -1;
+    p->timer = timer;
+    timewheel_add(&g_wheel, timer, now + ms);
+    return 0;
+}
+
+/**
+ * @brief Drops the wakeup deadline of a PCB, if it has one.
+ * @param p Pointer to the PCB.
+ */
+void waitchan_cancel(PCB *p) {
+    if (!p->timer) return;
+    timewheel_cancel(&g_wheel, p->timer);
+    pool_free(&g_timer_pool, p->timer);
+    p->timer = NULL;
+}
+
+/**
+ * @brief Returns the time left until a PCB's wakeup deadline.
+ * @param p Pointer to the PCB.
+ * @return Milliseconds left (0 if already due), or -1 if the PCB has no deadline.
+ */
+long long waitchan_remaining(const PCB *p) {
+    if (!p->timer) return -1;
+    const uint64_t now = WHEEL_NOW();
+    return p->timer->expires > now ? (long long)(p->timer->expires - now) : 0;
+}
+
+/**
+ * @brief Returns the number of PCBs with a wakeup deadline.
+ */
+unsigned long waitchan_sleeping(void) {
+    return g_wheel_ready ? (unsigned long)g_wheel.count : 0;
+}
+
+/**
+ * @brief Returns a uniformly distributed number in [0, 1) from a xorshift64* generator.
+ */
+static double next_uniform(void) {
+    if (g_rng_state == 0) g_rng_state = monotonic_us() ^ 0x9E3779B97F4A7C15ULL;
+    g_rng_state ^= g_rng_state >> 12;
+    g_rng_state ^= g_rng_state << 25;
+    g_rng_state ^= g_rng_state >> 27;
+    return (double)((g_rng_state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+/**
+ * @brief Draws a service time from the configured distribution.
+ * @return Milliseconds.
+ */
+static unsigned int sample_latency(void) {
+    switch (g_latency.kind) {
+        case LATENCY_FIXED:
+            return g_latency.min_ms;
+        case LATENCY_UNIFORM:
+            return g_latency.min_ms + (unsigned int)(next_uniform() * (g_latency.max_ms - g_latency.min_ms + 1.0));
+        case LATENCY_EXP: {
+            const double ms = -log(1.0 - next_uniform()) * g_latency.min_ms;
+            return ms >= WHEEL_MAX_DELAY ? (unsigned int)WHEEL_MAX_DELAY : (unsigned int)(ms + 0.5);
+        }
+        case LATENCY_NONE:
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Starts the simulated I/O of a PCB that has just parked on the I/O channel.
+ * @details Without a latency model the completion is posted to the channel at once; otherwise the
+ * PCB gets a wakeup deadline drawn from the configured distribution.
+ * @param p Pointer to the PCB, in the suspended-blocked queue.
+ */
+void waitchan_start_io(PCB *p) {
+    if (g_latency.kind == LATENCY_NONE || waitchan_sleep(p, sample_latency()) != 0) {
+        waitchan_post(WAIT_IO, 1);
+    }
+}
+
+/**
+ * @brief Selects the service-time distribution of the simulated I/O.
+ * @param latency The distribution.
+ */
+void waitchan_set_latency(const IoLatency *latency) {
+    g_latency = *latency;
+}
+
+/**
+ * @brief Gets the service-time distribution of the simulated I/O.
+ */
+const IoLatency *waitchan_get_latency(void) {
+    return &g_latency;
+}
+
+/**
+ * @brief Drops every wakeup deadline and releases the timers.
+ * @details cleanup_techos() calls it first, before cleanup_pcbs() frees the PCBs the timers point at.
+ */
+void waitchan_cleanup(void) {
+    if (!g_wheel_ready) return;
+    pool_reset(&g_timer_pool);
+    g_wheel_ready = false;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "imgindex.h"
+#include "scan.h"
+
+/*
+ * Microbenchmark of the interrupt byte scanner.
+ * Usage: scanbench [max_size_mib]
+ * Builds synthetic encoded images of several sizes and interrupt densities and runs each one to
+ * completion, slice by slice, with the original fgetc loop of the execute binary and with every
+ * scanning kernel the CPU supports. Each kernel's interrupt offsets are checked against the fgetc
+ * loop before its throughput is reported. The decoding kernels are then measured the same way
+ * against the per-byte decoder.
+ */
+
+/* Minimum measuring time per kernel and image, in seconds. */
+#define MIN_SECONDS 0.2
+
+static const size_t SIZES[] = { 4 << 10, 64 << 10, 1 << 20, 16 << 20, 64 << 20 };
+static const size_t SPACINGS[] = { 16, 256, 4096, 0 }; // mean bytes between interrupts, 0 for none
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Fills a buffer with encoded printable text and scatters interrupt bytes through it.
+ * @details Gaps between interrupts are uniform in [1, 2 * spacing - 1], so their mean is spacing.
+ */
+static void fill_image(unsigned char *data, const size_t size, const size_t spacing) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)(' ' + rand() % 95);
+        if (c == '!') c = '"';
+        data[i] = (unsigned char)(c + 5);
+    }
+    if (spacing == 0) return;
+    for (size_t i = (size_t)rand() % spacing; i < size; i += 1 + (size_t)rand() % (2 * spacing - 1)) {
+        data[i] = INTERRUPT_BYTE;
+    }
+}
+
+/**
+ * @brief Runs an image to completion with the original per-byte loop of the execute binary.
+ * @return The number of slices, with their interrupt offsets stored in offsets.
+ */
+static size_t run_fgetc(FILE *file, off_t *offsets) {
+    size_t slices = 0;
+    off_t start = 1; // execution resumes one byte past the stored offset, which starts at 0
+    for (;;) {
+        off_t counter = start;
+        fseeko(file, start, SEEK_SET);
+        int c = fgetc(file);
+        while (c != EOF && c - 5 != '!') {
+            counter++;
+            c = fgetc(file);
+        }
+        if (c == EOF) counter = 0;
+        offsets[slices++] = counter;
+        if (counter == 0) return slices;
+        start = counter + 1;
+    }
+}
+
+/**
+ * @brief Runs an image to completion with a scanning kernel, as the in-process engine does.
+ * @return The number of slices, with their interrupt offsets stored in offsets.
+ */
+static size_t run_kernel(const ScanFunction scan, const unsigned char *data, const size_t size, off_t *offsets) {
+    size_t slices = 0;
+    size_t start = 1;
+    for (;;) {
+        off_t next = 0;
+        if (start < size) {
+            const unsigned char *hit = scan(data + start, size - start);
+            if (hit) next = (off_t)(hit - data);
+        }
+        offsets[slices++] = next;
+        if (next == 0) return slices;
+        start = (size_t)next + 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_size = 16 << 20;
+    if (argc > 1) max_size = (size_t)strtoul(argv[1], NULL, 10) << 20;
+    srand(12345);
+
+    printf("Selected kernel: %s\n", scan_kernel_name());
+    printf("%10s %8s %9s %-9s %10s %9s\n", "size", "spacing", "slices", "kernel", "MiB/s", "speedup");
+
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]) && SIZES[s] <= max_size; s++) {
+        const size_t size = SIZES[s];
+        unsigned char *data = malloc(size);
+        off_t *expected = malloc((size + 1) * sizeof(off_t));
+        off_t *actual = malloc((size + 1) * sizeof(off_t));
+        FILE *file = tmpfile();
+        if (!data || !expected || !actual || !file) {
+            fprintf(stderr, "Out of memory.\n");
+            return 1;
+        }
+
+        for (size_t d = 0; d < sizeof(SPACINGS) / sizeof(SPACINGS[0]); d++) {
+            fill_image(data, size, SPACINGS[d]);
+            rewind(file);
+            if (fwrite(data, 1, size, file) != size || fflush(file) != 0) {
+                perror("Error writing image.");
+                return 1;
+            }
+
+            double fgetc_rate = 0;
+            size_t slices = 0;
+            for (size_t k = 0; k <= scan_kernel_count(); k++) {
+                const ScanKernel *kernel = k == 0 ? NULL : scan_kernel(k - 1);
+                size_t runs = 0;
+                const double start = now_seconds();
+                double elapsed;
+                do {
+                    const size_t n = kernel ? run_kernel(kernel->scan, data, size, actual)
+                                            : run_fgetc(file, expected);
+                    if (kernel && (n != slices || memcmp(actual, expected, n * sizeof(off_t)) != 0)) {
+                        printf("MISMATCH: kernel %s, size %zu, spacing %zu\n", kernel->name, size, SPACINGS[d]);
+                        failed = 1;
+                    }
+                    slices = n;
+                    runs++;
+                    elapsed = now_seconds() - start;
+                } while (elapsed < MIN_SECONDS);
+
+                const double rate = (double)size * (double)runs / elapsed / (1 << 20);
+                if (!kernel) fgetc_rate = rate;
+                printf("%10zu %8zu %9zu %-9s %10.1f %8.1fx\n", size, SPACINGS[d], slices,
+                       kernel ? kernel->name : "fgetc", rate, rate / fgetc_rate);
+            }
+        }
+        fclose(file);
+        free(data);
+        free(expected);
+        free(actual);
+    }
+
+    /* Decoding: every kernel must agree with the per-byte subtraction for every byte value. */
+    const size_t size = 1 << 20;
+    unsigned char *encoded = malloc(size);
+    unsigned char *expected = malloc(size);
+    unsigned char *decoded = malloc(size);
+    if (!encoded || !expected || !decoded) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++) encoded[i] = (unsigned char)rand();
+    const ScanKernel *reference = scan_kernel(scan_kernel_count() - 1);
+    reference->decode(expected, encoded, size);
+
+    printf("\n%10s %-9s %10s %9s\n", "size", "decoder", "MiB/s", "speedup");
+    double reference_rate = 0;
+    for (size_t k = scan_kernel_count(); k-- > 0;) {
+        const ScanKernel *kernel = scan_kernel(k);
+        size_t runs = 0;
+        const double start = now_seconds();
+        double elapsed;
+        do {
+            kernel->decode(decoded, encoded, size);
+            runs++;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+        if (memcmp(decoded, expected, size) != 0) {
+            printf("MISMATCH: decoder %s\n", kernel->name);
+            failed = 1;
+        }
+        const double rate = (double)size * (double)runs / elapsed / (1 << 20);
+        if (kernel == reference) reference_rate = rate;
+        printf("%10zu %-9s %10.1f %8.1fx\n", size, kernel->name, rate, rate / reference_rate);
+    }
+    free(encoded);
+    free(expected);
+    free(decoded);
+    return failed;
+}
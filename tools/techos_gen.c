@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "imgindex.h"
+
+/*
+ * Synthetic process image generator.
+ * Writes .techos images of a given size with interrupts spaced according to a chosen distribution,
+ * and optionally a TechOS batch script that loads them as PCBs and dispatches them. Output is fully
+ * determined by the seed, so workloads can be reproduced exactly.
+ */
+
+#define CHUNK_BYTES (1 << 20)
+#define MAX_SCRIPT_PCBS 9999999 // PCB names are 'g' followed by seven digits
+
+typedef enum { GAP_FIXED, GAP_UNIFORM, GAP_EXPONENTIAL, GAP_BURSTY } GapDistribution;
+typedef enum { ENCODING_SHIFT5, ENCODING_RAW } Encoding;
+
+typedef struct {
+    const char *prefix;
+    unsigned long count;
+    unsigned long long size;
+    unsigned long long spacing; // mean bytes between interrupts, 0 for none
+    GapDistribution distribution;
+    Encoding encoding;
+    unsigned long pcbs;
+    const char *script;
+    uint64_t seed;
+} GenOptions;
+
+/* Printable text, 64 symbols so one random word yields ten of them. */
+static const char ALPHABET[64] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 \n";
+
+static uint64_t g_rng_state;
+
+/**
+ * @brief splitmix64: small, fast and identical on every platform.
+ */
+static uint64_t next_random(void) {
+    uint64_t z = (g_rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns a uniform double in (0, 1].
+ */
+static double next_unit(void) {
+    return ((double)(next_random() >> 11) + 1.0) / 9007199254740992.0;
+}
+
+/**
+ * @brief Draws the distance to the next interrupt. Every distribution has the requested mean.
+ * @details Bursty gaps mix short gaps (90%, mean spacing / 10) with long ones (10%, mean 9.1 * spacing).
+ */
+static unsigned long long next_gap(const GenOptions *opt) {
+    const double mean = (double)opt->spacing;
+    double gap;
+    switch (opt->distribution) {
+        case GAP_FIXED: gap = mean; break;
+        case GAP_UNIFORM: gap = 1 + (double)(next_random() % (2 * opt->spacing - 1)); break;
+        case GAP_EXPONENTIAL: gap = -mean * log(next_unit()); break;
+        default: {
+            const double burst_mean = next_random() % 10 ? mean / 10 : mean * 9.1;
+            gap = -burst_mean * log(next_unit());
+        }
+    }
+    return gap < 1 ? 1 : (unsigned long long)gap;
+}
+
+/**
+ * @brief Fills a buffer with encoded content that contains no interrupt byte.
+ */
+static void fill_content(unsigned char *buf, const size_t len, const Encoding encoding) {
+    size_t i = 0;
+    while (i < len) {
+        uint64_t r = next_random();
+        for (int k = 0; k < 8 && i < len; k++, r >>= 8) {
+            unsigned char c;
+            if (encoding == ENCODING_RAW) {
+                c = (unsigned char)r;
+                if (c == INTERRUPT_BYTE) c++;
+            } else {
+                c = (unsigned char)(ALPHABET[r & 63] + 5);
+            }
+            buf[i++] = c;
+        }
+    }
+}
+
+/**
+ * @brief Writes one image.
+ * @return The number of interrupts written, or -1 on failure.
+ */
+static long long write_image(const GenOptions *opt, const char *path, unsigned char *buf) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    long long interrupts = 0;
+    unsigned long long pos = 0;
+    unsigned long long next = opt->spacing ? next_gap(opt) : opt->size;
+    while (pos < opt->size) {
+        const size_t len = opt->size - pos < CHUNK_BYTES ? (size_t)(opt->size - pos) : CHUNK_BYTES;
+        fill_content(buf, len, opt->encoding);
+        while (next < pos + len) {
+            buf[next - pos] = INTERRUPT_BYTE;
+            interrupts++;
+            next += next_gap(opt);
+        }
+        if (fwrite(buf, 1, len, file) != len) {
+            perror(path);
+            fclose(file);
+            return -1;
+        }
+        pos += len;
+    }
+    if (fclose(file) != 0) {
+        perror(path);
+        return -1;
+    }
+    return interrupts;
+}
+
+/**
+ * @brief Writes a batch script that loads the images round-robin and dispatches them.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_script(const GenOptions *opt) {
+    FILE *file = fopen(opt->script, "w");
+    if (!file) {
+        perror(opt->script);
+        return -1;
+    }
+    for (unsigned long i = 0; i < opt->pcbs; i++) {
+        fprintf(file, "loadpcb g%07lu %d %s%lu\n", i + 1, (int)(next_random() % 10), opt->prefix, i % opt->count);
+    }
+    fprintf(file, "dispatchpcbs\n");
+    if (fclose(file) != 0) {
+        perror(opt->script);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a size with an optional K, M or G suffix.
+ * @return 1 if valid, 0 otherwise.
+ */
+static int parse_size(const char *str, unsigned long long *out) {
+    char *end;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (end == str) return 0;
+    switch (*end) {
+        case 'K': case 'k': value <<= 10; end++; break;
+        case 'M': case 'm': value <<= 20; end++; break;
+        case 'G': case 'g': value <<= 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0') return 0;
+    *out = value;
+    return 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -o <prefix>    Output path prefix; images are <prefix>N.techos (default: gen)\n"
+            "  -n <count>     Number of images (default: 1)\n"
+            "  -s <size>      Image size in bytes, with optional K, M or G suffix (default: 64K)\n"
+            "  -i <bytes>     Mean bytes between interrupts, 0 for none (default: 256)\n"
+            "  -d <dist>      Interrupt spacing: fixed, uniform, exponential or bursty (default: uniform)\n"
+            "  -e <encoding>  shift5 (printable text shifted by 5) or raw (random bytes) (default: shift5)\n"
+            "  -b <script>    Also write a batch script of loadpcb commands followed by dispatchpcbs\n"
+            "  -p <pcbs>      PCBs in the batch script, loading the images round-robin (default: one per image)\n"
+            "  -r <seed>      Random seed (default: 1)\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    GenOptions opt = { "gen", 1, 64 << 10, 256, GAP_UNIFORM, ENCODING_SHIFT5, 0, NULL, 1 };
+
+    int c;
+    while ((c = getopt(argc, argv, "o:n:s:i:d:e:b:p:r:")) != -1) {
+        int ok = 1;
+        switch (c) {
+            case 'o': opt.prefix = optarg; break;
+            case 'n': opt.count = strtoul(optarg, NULL, 10); ok = opt.count > 0; break;
+            case 's': ok = parse_size(optarg, &opt.size); break;
+            case 'i': ok = parse_size(optarg, &opt.spacing); break;
+            case 'd':
+                if (strcmp(optarg, "fixed") == 0) opt.distribution = GAP_FIXED;
+                else if (strcmp(optarg, "uniform") == 0) opt.distribution = GAP_UNIFORM;
+                else if (strcmp(optarg, "exponential") == 0) opt.distribution = GAP_EXPONENTIAL;
+                else if (strcmp(optarg, "bursty") == 0) opt.distribution = GAP_BURSTY;
+                else ok = 0;
+                break;
+            case 'e':
+                if (strcmp(optarg, "shift5") == 0) opt.encoding = ENCODING_SHIFT5;
+                else if (strcmp(optarg, "raw") == 0) opt.encoding = ENCODING_RAW;
+                else ok = 0;
+                break;
+            case 'b': opt.script = optarg; break;
+            case 'p': opt.pcbs = strtoul(optarg, NULL, 10); ok = opt.pcbs > 0 && opt.pcbs <= MAX_SCRIPT_PCBS; break;
+            case 'r': opt.seed = strtoull(optarg, NULL, 10); break;
+            default: ok = 0;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.pcbs == 0) opt.pcbs = opt.count < MAX_SCRIPT_PCBS ? opt.count : MAX_SCRIPT_PCBS;
+    g_rng_state = opt.seed;
+
+    unsigned char *buf = malloc(CHUNK_BYTES);
+    if (!buf) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    for (unsigned long i = 0; i < opt.count; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s%lu.techos", opt.prefix, i);
+        const long long interrupts = write_image(&opt, path, buf);
+        if (interrupts < 0) {
+            free(buf);
+            return 1;
+        }
+        printf("Wrote %s (%llu bytes, %lld interrupts)\n", path, opt.size, interrupts);
+    }
+    free(buf);
+
+    if (opt.script) {
+        if (write_script(&opt) != 0) return 1;
+        printf("Wrote %s (%lu PCBs)\n", opt.script, opt.pcbs);
+    }
+    return 0;
+}